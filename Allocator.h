@@ -0,0 +1,148 @@
+/** @file */
+#ifndef __ALLOCATOR_H
+#define __ALLOCATOR_H
+
+#include <new>
+#include <type_traits>
+
+/**
+ * Node allocators for the node-based containers. An allocator hands out raw
+ * memory for one object of type T at a time; the container constructs and
+ * destroys the object itself.
+ *
+ * An allocator should be a class template with the following members:
+ * @code
+ *      static const bool bulk;     // true if release() frees every node at once
+ *      void *allocate();           // memory for one T
+ *      void deallocate(T *p);      // give back the memory of a destroyed T
+ *      void release();             // forget every node handed out so far
+ * @endcode
+ */
+
+/**
+ * HeapAllocator takes every node from operator new, one by one.
+ */
+template <class T>
+class HeapAllocator
+{
+public:
+    static const bool bulk=false;
+
+    void *allocate()
+    {
+        return ::operator new(sizeof(T));
+    }
+
+    void deallocate(T *p)
+    {
+        ::operator delete(p);
+    }
+
+    void release()
+    {
+    }
+};
+
+/**
+ * ArenaAllocator is a monotonic arena: nodes are bump-allocated from blocks of
+ * growing size, so the nodes built one after another are contiguous in memory.
+ * Freed nodes are kept in a free list and reused. release() and the destructor
+ * give back all the blocks at once, which costs O(blocks) instead of one free()
+ * per node.
+ */
+template <class T>
+class ArenaAllocator
+{
+public:
+    static const bool bulk=true;
+
+    ArenaAllocator():blocks(0),freeList(0),cursor(0),left(0),blockSize(minBlock)
+    {
+    }
+
+    ~ArenaAllocator()
+    {
+        release();
+    }
+
+    ArenaAllocator(const ArenaAllocator &x)=delete;
+    ArenaAllocator &operator=(const ArenaAllocator &x)=delete;
+
+    /**
+     * TODO Returns memory for one T, from the free list if possible.
+     */
+    void *allocate()
+    {
+        if(freeList)
+        {
+            Slot *a=freeList;
+            freeList=a->next;
+            return a;
+        }
+        if(!left)newBlock();
+        left--;
+        return cursor++;
+    }
+
+    /**
+     * TODO Puts the memory of a destroyed T to the free list.
+     */
+    void deallocate(T *p)
+    {
+        Slot *a=reinterpret_cast<Slot *>(p);
+        a->next=freeList;
+        freeList=a;
+    }
+
+    /**
+     * TODO Gives back all the blocks. Every pointer handed out before becomes invalid.
+     */
+    void release()
+    {
+        while(blocks)
+        {
+            Slot *a=blocks;
+            blocks=blocks->next;
+            ::operator delete(a);
+        }
+        freeList=cursor=0;
+        left=0;
+        blockSize=minBlock;
+    }
+private:
+    /**
+     * A slot holds a T, or the link of the free list (or of the block list) when unused.
+     */
+    union Slot
+    {
+        Slot *next;
+        typename std::aligned_storage<sizeof(T),alignof(T)>::type data;
+    };
+
+    static const int minBlock=32,maxBlock=4096;
+
+    /**
+     * @param blocks the list of blocks, linked through their first slot.
+     * @param freeList the list of the freed slots.
+     * @param cursor the next unused slot of the current block.
+     * @param left the number of unused slots in the current block.
+     * @param blockSize the number of slots of the next block.
+     */
+    Slot *blocks,*freeList,*cursor;
+    int left,blockSize;
+
+    /**
+     * TODO allocate a new block, whose first slot links to the previous block.
+     */
+    void newBlock()
+    {
+        Slot *a=static_cast<Slot *>(::operator new(sizeof(Slot)*(blockSize+1)));
+        a->next=blocks;
+        blocks=a;
+        cursor=a+1;
+        left=blockSize;
+        if(blockSize<maxBlock)blockSize*=2;
+    }
+};
+
+#endif
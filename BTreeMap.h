@@ -0,0 +1,667 @@
+/** @file */
+
+#ifndef __BTREEMAP_H
+#define __BTREEMAP_H
+
+#include "ElementNotExist.h"
+#include <type_traits>
+#ifdef __SSE2__
+#include <emmintrin.h>
+#endif
+
+/**
+ * TODO the number of keys[0..n) less than key, by a branchless scan for the
+ * arithmetic keys of BTreeMap.
+ */
+template <class K>
+inline int btreeCountLess(const K *keys,int n,const K &key)
+{
+    int res=0;
+    for(int i=0;i<n;++i)res+=(keys[i]<key);
+    return res;
+}
+
+/**
+ * TODO the number of keys[0..n) less than or equal to key, as btreeCountLess().
+ */
+template <class K>
+inline int btreeCountNotGreater(const K *keys,int n,const K &key)
+{
+    int res=0;
+    for(int i=0;i<n;++i)res+=!(key<keys[i]);
+    return res;
+}
+
+#ifdef __SSE2__
+inline int btreeCountLess(const int *keys,int n,const int &key)
+{
+    __m128i k=_mm_set1_epi32(key);
+    int res=0,i=0;
+    for(;i+4<=n;i+=4)
+    {
+        __m128i a=_mm_loadu_si128(reinterpret_cast<const __m128i *>(keys+i));
+        res+=__builtin_popcount(_mm_movemask_ps(_mm_castsi128_ps(_mm_cmplt_epi32(a,k))));
+    }
+    for(;i<n;++i)res+=(keys[i]<key);
+    return res;
+}
+
+inline int btreeCountNotGreater(const int *keys,int n,const int &key)
+{
+    __m128i k=_mm_set1_epi32(key);
+    int res=n,i=0;
+    for(;i+4<=n;i+=4)
+    {
+        __m128i a=_mm_loadu_si128(reinterpret_cast<const __m128i *>(keys+i));
+        res-=__builtin_popcount(_mm_movemask_ps(_mm_castsi128_ps(_mm_cmpgt_epi32(a,k))));
+    }
+    for(;i<n;++i)res-=(key<keys[i]);
+    return res;
+}
+#endif
+
+/**
+ * BTreeMap is a B+-tree implementation of map, with the same interface as TreeMap.
+ * The iterators iterate through the map in the natural order (operator<) of the key.
+ *
+ * Every node holds up to CAPACITY keys packed in an array of about four cache lines,
+ * so a lookup touches O(log n / log CAPACITY) nodes instead of the O(log n)
+ * scattered nodes of TreeMap. The entries are only stored in the leaves, which
+ * are linked for the iteration.
+ *
+ * Inside a node, arithmetic keys are searched by a branchless scan which the
+ * compiler can vectorize (and which uses SSE2 for int keys when available),
+ * other keys by a binary search.
+ *
+ * As the keys and the values are stored in separate arrays, the iterator returns
+ * an Entry which only refers to them, so it is valid until the next call to next().
+ */
+template<class K, class V>
+class BTreeMap
+{
+public:
+    class Entry
+    {
+        const K *key;
+        const V *value;
+    public:
+        Entry():key(0),value(0){}
+
+        const K &getKey() const
+        {
+            return *key;
+        }
+
+        const V &getValue() const
+        {
+            return *value;
+        }
+
+        friend class BTreeMap<K,V>;
+    };
+
+    class Iterator
+    {
+    public:
+        /**
+         * TODO Returns true if the iteration has more elements.
+         */
+        bool hasNext()
+        {
+            return leaf!=0;
+        }
+
+        /**
+         * TODO Returns the next element in the iteration.
+         * @throw ElementNotExist exception when hasNext() == false
+         */
+        const Entry &next()
+        {
+            if(!hasNext())throw ElementNotExist();
+            entry.key=&leaf->keys[index];
+            entry.value=&leaf->values[index];
+            if(++index==leaf->count)
+            {
+                leaf=leaf->next;
+                index=0;
+            }
+            return entry;
+        }
+
+        /**
+         * TODO Constructor
+         */
+        Iterator(const BTreeMap<K,V> *c=0):leaf(c?c->firstLeaf():0),index(0)
+        {
+        }
+    private:
+        /**
+         * @param leaf the leaf of the next element, 0 at the end.
+         * @param index the position of the next element in leaf.
+         * @param entry the entry returned by next().
+         */
+        struct BTreeMap<K,V>::Leaf *leaf;
+        int index;
+        Entry entry;
+    };
+
+    /**
+     * TODO Constructs an empty map.
+     */
+    BTreeMap():amount(0),root(0)
+    {
+    }
+
+    /**
+     * TODO Destructor
+     */
+    ~BTreeMap()
+    {
+        clear();
+    }
+
+    /**
+     * TODO Assignment operator
+     */
+    BTreeMap &operator=(const BTreeMap &x)
+    {
+        if(&x!=this)
+        {
+            clear();
+            Leaf *last=0;
+            root=copy(x.root,last);
+            amount=x.amount;
+        }
+        return *this;
+    }
+
+    /**
+     * TODO Copy-constructor. The nodes are copied one by one, in O(n) time.
+     */
+    BTreeMap(const BTreeMap &x)
+    {
+        Leaf *last=0;
+        root=copy(x.root,last);
+        amount=x.amount;
+    }
+
+    /**
+     * TODO Returns an iterator over the elements in this map.
+     */
+    Iterator iterator() const
+    {
+        return Iterator(this);
+    }
+
+    /**
+     * TODO Removes all of the mappings from this map.
+     */
+    void clear()
+    {
+        removeall(root);
+        root=0;
+        amount=0;
+    }
+
+    /**
+     * TODO Returns true if this map contains a mapping for the specified key.
+     */
+    bool containsKey(const K &key) const
+    {
+        int i;
+        return find(key,i)!=0;
+    }
+
+    /**
+     * TODO Returns true if this map maps one or more keys to the specified value.
+     */
+    bool containsValue(const V &value) const
+    {
+        for(Leaf *a=firstLeaf();a;a=a->next)
+            for(int i=0;i<a->count;++i)
+                if(a->values[i]==value)return 1;
+        return 0;
+    }
+
+    /**
+     * TODO Returns a const reference to the value to which the specified key is mapped.
+     * If the key is not present in this map, this function should throw ElementNotExist exception.
+     * @throw ElementNotExist
+     */
+    const V &get(const K &key) const
+    {
+        int i;
+        Leaf *a=find(key,i);
+        if(!a)throw ElementNotExist();
+        return a->values[i];
+    }
+
+    /**
+     * TODO Returns true if this map contains no key-value mappings.
+     */
+    bool isEmpty() const
+    {
+        return (amount==0);
+    }
+
+    /**
+     * TODO Associates the specified value with the specified key in this map.
+     */
+    void put(const K &key, const V &value)
+    {
+        if(!root)root=new Leaf;
+        Inner *path[MAXDEPTH];
+        int slot[MAXDEPTH],depth=0;
+        Node *w=root;
+        while(!w->leaf)
+        {
+            Inner *a=static_cast<Inner *>(w);
+            path[depth]=a;
+            slot[depth]=countNotGreater(a->keys,a->count,key);
+            w=a->child[slot[depth++]];
+        }
+        Leaf *leaf=static_cast<Leaf *>(w);
+        int i=countLess(leaf->keys,leaf->count,key);
+        if(i<leaf->count && !(key<leaf->keys[i]))
+        {
+            leaf->values[i]=value;
+            return;
+        }
+        for(int j=leaf->count;j>i;--j)
+        {
+            leaf->keys[j]=leaf->keys[j-1];
+            leaf->values[j]=leaf->values[j-1];
+        }
+        leaf->keys[i]=key;
+        leaf->values[i]=value;
+        leaf->count++;
+        amount++;
+        if(leaf->count<CAPACITY)return;
+
+        K separator;
+        Node *right=splitLeaf(leaf,separator);
+        while(depth>0)
+        {
+            Inner *a=path[--depth];
+            int s=slot[depth];
+            for(int j=a->count;j>s;--j)
+            {
+                a->keys[j]=a->keys[j-1];
+                a->child[j+1]=a->child[j];
+            }
+            a->keys[s]=separator;
+            a->child[s+1]=right;
+            a->count++;
+            if(a->count<CAPACITY)return;
+            right=splitInner(a,separator);
+        }
+        Inner *a=new Inner;
+        a->keys[0]=separator;
+        a->child[0]=root;
+        a->child[1]=right;
+        a->count=1;
+        root=a;
+    }
+
+    /**
+     * TODO Removes the mapping for the specified key from this map if present.
+     * If there is no mapping for the specified key, throws ElementNotExist exception.
+     * @throw ElementNotExist
+     */
+    void remove(const K &key)
+    {
+        Inner *path[MAXDEPTH];
+        int slot[MAXDEPTH],depth=0;
+        Node *w=root;
+        if(!w)throw ElementNotExist();
+        while(!w->leaf)
+        {
+            Inner *a=static_cast<Inner *>(w);
+            path[depth]=a;
+            slot[depth]=countNotGreater(a->keys,a->count,key);
+            w=a->child[slot[depth++]];
+        }
+        Leaf *leaf=static_cast<Leaf *>(w);
+        int i=countLess(leaf->keys,leaf->count,key);
+        if(i==leaf->count || key<leaf->keys[i])throw ElementNotExist();
+        for(int j=i+1;j<leaf->count;++j)
+        {
+            leaf->keys[j-1]=leaf->keys[j];
+            leaf->values[j-1]=leaf->values[j];
+        }
+        leaf->count--;
+        amount--;
+
+        for(w=leaf;depth>0 && w->count<MINIMUM;)
+        {
+            Inner *a=path[--depth];
+            if(w->leaf)fixLeaf(a,slot[depth]);else fixInner(a,slot[depth]);
+            w=a;
+        }
+        if(root->count==0)
+        {
+            Node *old=root;
+            root=root->leaf?0:static_cast<Inner *>(root)->child[0];
+            if(old->leaf)delete static_cast<Leaf *>(old);else delete static_cast<Inner *>(old);
+        }
+    }
+
+    /**
+     * TODO Returns the number of key-value mappings in this map.
+     */
+    int size() const
+    {
+        return amount;
+    }
+
+private:
+    /**
+     * CAPACITY is chosen so that the keys of a node fill about 256 bytes.
+     * A node splits when it gets CAPACITY keys, and is merged with or borrows
+     * from a sibling when it has less than MINIMUM keys.
+     */
+    static const int CAPACITY=sizeof(K)*8>256?8:256/sizeof(K);
+    static const int MINIMUM=(CAPACITY-1)/2;
+    static const int MAXDEPTH=64;
+
+    struct Node
+    {
+        int count;
+        bool leaf;
+        Node(bool _leaf):count(0),leaf(_leaf){}
+    };
+
+    struct Leaf:Node
+    {
+        K keys[CAPACITY];
+        V values[CAPACITY];
+        Leaf *next;
+        Leaf():Node(1),next(0){}
+    };
+
+    /**
+     * keys[i] separates the keys of child[i], which are less than it, from the
+     * keys of child[i+1], which are greater than or equal to it.
+     */
+    struct Inner:Node
+    {
+        K keys[CAPACITY];
+        Node *child[CAPACITY+1];
+        Inner():Node(0){}
+    };
+
+    /**
+     * @param amount the number of the entries.
+     * @param root the root of the tree, 0 when the map is empty.
+     */
+    int amount;
+    Node *root;
+
+    Leaf *firstLeaf() const
+    {
+        Node *w=root;
+        if(!w)return 0;
+        while(!w->leaf)w=static_cast<Inner *>(w)->child[0];
+        return static_cast<Leaf *>(w);
+    }
+
+    /**
+     * TODO Returns the leaf holding key and its position in i, or 0 if the key
+     * is not present.
+     */
+    Leaf *find(const K &key,int &i) const
+    {
+        Node *w=root;
+        if(!w)return 0;
+        while(!w->leaf)
+        {
+            Inner *a=static_cast<Inner *>(w);
+            w=a->child[countNotGreater(a->keys,a->count,key)];
+        }
+        Leaf *a=static_cast<Leaf *>(w);
+        i=countLess(a->keys,a->count,key);
+        if(i==a->count || key<a->keys[i])return 0;
+        return a;
+    }
+
+    /**
+     * TODO the number of keys[0..n) less than key, that is the position of key.
+     */
+    static int countLess(const K *keys,int n,const K &key)
+    {
+        return countLess(keys,n,key,std::is_arithmetic<K>());
+    }
+
+    /**
+     * TODO the number of keys[0..n) less than or equal to key, that is the child
+     * of an inner node where key is.
+     */
+    static int countNotGreater(const K *keys,int n,const K &key)
+    {
+        return countNotGreater(keys,n,key,std::is_arithmetic<K>());
+    }
+
+    static int countLess(const K *keys,int n,const K &key,std::true_type)
+    {
+        return btreeCountLess(keys,n,key);
+    }
+
+    static int countNotGreater(const K *keys,int n,const K &key,std::true_type)
+    {
+        return btreeCountNotGreater(keys,n,key);
+    }
+
+    static int countLess(const K *keys,int n,const K &key,std::false_type)
+    {
+        int l=0,r=n;
+        while(l<r)
+        {
+            int m=(l+r)/2;
+            if(keys[m]<key)l=m+1;else r=m;
+        }
+        return l;
+    }
+
+    static int countNotGreater(const K *keys,int n,const K &key,std::false_type)
+    {
+        int l=0,r=n;
+        while(l<r)
+        {
+            int m=(l+r)/2;
+            if(key<keys[m])r=m;else l=m+1;
+        }
+        return l;
+    }
+
+    /**
+     * TODO move the upper half of a full leaf to a new leaf, which is returned.
+     * separator is set to its first key.
+     */
+    Leaf *splitLeaf(Leaf *a,K &separator)
+    {
+        Leaf *b=new Leaf;
+        int half=a->count/2;
+        for(int i=half;i<a->count;++i)
+        {
+            b->keys[i-half]=a->keys[i];
+            b->values[i-half]=a->values[i];
+        }
+        b->count=a->count-half;
+        a->count=half;
+        b->next=a->next;
+        a->next=b;
+        separator=b->keys[0];
+        return b;
+    }
+
+    /**
+     * TODO move the upper half of a full inner node to a new node, which is returned.
+     * The middle key moves up and is returned in separator.
+     */
+    Inner *splitInner(Inner *a,K &separator)
+    {
+        Inner *b=new Inner;
+        int half=a->count/2;
+        separator=a->keys[half];
+        for(int i=half+1;i<a->count;++i)b->keys[i-half-1]=a->keys[i];
+        for(int i=half+1;i<=a->count;++i)b->child[i-half-1]=a->child[i];
+        b->count=a->count-half-1;
+        a->count=half;
+        return b;
+    }
+
+    /**
+     * TODO remove keys[s] and child[s+1] from the inner node a.
+     */
+    static void eraseSlot(Inner *a,int s)
+    {
+        for(int j=s+1;j<a->count;++j)
+        {
+            a->keys[j-1]=a->keys[j];
+            a->child[j]=a->child[j+1];
+        }
+        a->count--;
+    }
+
+    /**
+     * TODO refill the leaf child[s] of a, which has too few keys, by borrowing a key
+     * from a sibling, or by merging it with a sibling.
+     */
+    void fixLeaf(Inner *a,int s)
+    {
+        Leaf *w=static_cast<Leaf *>(a->child[s]);
+        Leaf *l=s>0?static_cast<Leaf *>(a->child[s-1]):0;
+        Leaf *r=s<a->count?static_cast<Leaf *>(a->child[s+1]):0;
+        if(l && l->count>MINIMUM)
+        {
+            for(int j=w->count;j>0;--j)
+            {
+                w->keys[j]=w->keys[j-1];
+                w->values[j]=w->values[j-1];
+            }
+            l->count--;
+            w->keys[0]=l->keys[l->count];
+            w->values[0]=l->values[l->count];
+            w->count++;
+            a->keys[s-1]=w->keys[0];
+        }else if(r && r->count>MINIMUM)
+        {
+            w->keys[w->count]=r->keys[0];
+            w->values[w->count]=r->values[0];
+            w->count++;
+            for(int j=1;j<r->count;++j)
+            {
+                r->keys[j-1]=r->keys[j];
+                r->values[j-1]=r->values[j];
+            }
+            r->count--;
+            a->keys[s]=r->keys[0];
+        }else
+        {
+            if(l)
+            {
+                r=w;
+                w=l;
+                s--;
+            }
+            for(int j=0;j<r->count;++j)
+            {
+                w->keys[w->count+j]=r->keys[j];
+                w->values[w->count+j]=r->values[j];
+            }
+            w->count+=r->count;
+            w->next=r->next;
+            delete r;
+            eraseSlot(a,s);
+        }
+    }
+
+    /**
+     * TODO refill the inner node child[s] of a, which has too few keys, by rotating
+     * a key through a from a sibling, or by merging it with a sibling.
+     */
+    void fixInner(Inner *a,int s)
+    {
+        Inner *w=static_cast<Inner *>(a->child[s]);
+        Inner *l=s>0?static_cast<Inner *>(a->child[s-1]):0;
+        Inner *r=s<a->count?static_cast<Inner *>(a->child[s+1]):0;
+        if(l && l->count>MINIMUM)
+        {
+            w->child[w->count+1]=w->child[w->count];
+            for(int j=w->count;j>0;--j)
+            {
+                w->keys[j]=w->keys[j-1];
+                w->child[j]=w->child[j-1];
+            }
+            w->keys[0]=a->keys[s-1];
+            w->child[0]=l->child[l->count];
+            w->count++;
+            a->keys[s-1]=l->keys[l->count-1];
+            l->count--;
+        }else if(r && r->count>MINIMUM)
+        {
+            w->keys[w->count]=a->keys[s];
+            w->child[w->count+1]=r->child[0];
+            w->count++;
+            a->keys[s]=r->keys[0];
+            for(int j=1;j<r->count;++j)r->keys[j-1]=r->keys[j];
+            for(int j=1;j<=r->count;++j)r->child[j-1]=r->child[j];
+            r->count--;
+        }else
+        {
+            if(l)
+            {
+                r=w;
+                w=l;
+                s--;
+            }
+            w->keys[w->count]=a->keys[s];
+            for(int j=0;j<r->count;++j)w->keys[w->count+1+j]=r->keys[j];
+            for(int j=0;j<=r->count;++j)w->child[w->count+1+j]=r->child[j];
+            w->count+=r->count+1;
+            delete r;
+            eraseSlot(a,s);
+        }
+    }
+
+    /**
+     * TODO copy the subtree v. last is the last leaf copied so far, to which the
+     * leaves of the copy are linked.
+     */
+    Node *copy(Node *v,Leaf *&last)
+    {
+        if(!v)return 0;
+        if(v->leaf)
+        {
+            Leaf *a=new Leaf(*static_cast<Leaf *>(v));
+            a->next=0;
+            if(last)last->next=a;
+            last=a;
+            return a;
+        }
+        Inner *b=static_cast<Inner *>(v),*a=new Inner;
+        a->count=b->count;
+        for(int i=0;i<b->count;++i)a->keys[i]=b->keys[i];
+        for(int i=0;i<=b->count;++i)a->child[i]=copy(b->child[i],last);
+        return a;
+    }
+
+    /**
+     * TODO delete the subtree v. The depth is O(log n / log CAPACITY), so the
+     * recursion is shallow.
+     */
+    void removeall(Node *v)
+    {
+        if(!v)return;
+        if(v->leaf)
+        {
+            delete static_cast<Leaf *>(v);
+            return;
+        }
+        Inner *a=static_cast<Inner *>(v);
+        for(int i=0;i<=a->count;++i)removeall(a->child[i]);
+        delete a;
+    }
+};
+
+#endif
@@ -0,0 +1,187 @@
+/** @file */
+#ifndef __CONCURRENTHASHMAP_H
+#define __CONCURRENTHASHMAP_H
+
+#include "HashMap.h"
+#include "ElementNotExist.h"
+#include <mutex>
+
+/**
+ * ConcurrentHashMap is a HashMap which can be shared between threads.
+ *
+ * The keys are spread over a number of shards, and every shard is an ordinary
+ * HashMap guarded by its own mutex (lock striping). Two threads only contend
+ * when their keys fall into the same shard, so the throughput keeps growing with
+ * the number of threads instead of being capped by one global lock.
+ *
+ * Template argument H follows exactly the same contract as in HashMap:
+ * a class with a static function ``hashCode'' taking a K and returning an int.
+ *
+ * Since another thread may remove or modify an entry at any time, get() returns
+ * the value by copy instead of by reference, and there is no iterator.
+ */
+template <class K, class V, class H>
+class ConcurrentHashMap
+{
+public:
+    /**
+     * TODO Constructs an empty map. The number of shards is rounded up to a
+     * power of 2.
+     */
+    ConcurrentHashMap(int _shards=64)
+    {
+        for(shards=1;shards<_shards;shards<<=1);
+        shard=new Shard[shards];
+    }
+
+    /**
+     * TODO Destructor
+     */
+    ~ConcurrentHashMap()
+    {
+        delete [] shard;
+    }
+
+    ConcurrentHashMap(const ConcurrentHashMap &x)=delete;
+    ConcurrentHashMap &operator=(const ConcurrentHashMap &x)=delete;
+
+    /**
+     * TODO Removes all of the mappings from this map.
+     */
+    void clear()
+    {
+        for(int i=0;i<shards;++i)
+        {
+            std::lock_guard<std::mutex> guard(shard[i].lock);
+            shard[i].map.clear();
+        }
+    }
+
+    /**
+     * TODO Returns true if this map contains a mapping for the specified key.
+     */
+    bool containsKey(const K &key) const
+    {
+        Shard &s=getShard(key);
+        std::lock_guard<std::mutex> guard(s.lock);
+        return s.map.containsKey(key);
+    }
+
+    /**
+     * TODO Returns a copy of the value to which the specified key is mapped.
+     * If the key is not present in this map, this function should throw ElementNotExist exception.
+     * @throw ElementNotExist
+     */
+    V get(const K &key) const
+    {
+        Shard &s=getShard(key);
+        std::lock_guard<std::mutex> guard(s.lock);
+        return s.map.get(key);
+    }
+
+    /**
+     * TODO Returns true if this map contains no key-value mappings.
+     */
+    bool isEmpty() const
+    {
+        return size()==0;
+    }
+
+    /**
+     * TODO Associates the specified value with the specified key in this map.
+     */
+    void put(const K &key, const V &value)
+    {
+        Shard &s=getShard(key);
+        std::lock_guard<std::mutex> guard(s.lock);
+        s.map.put(key,value);
+    }
+
+    /**
+     * TODO Associates the value with the key only if the key is not present yet.
+     * The test and the insertion are done atomically.
+     * Returns true if the value was inserted.
+     */
+    bool putIfAbsent(const K &key, const V &value)
+    {
+        Shard &s=getShard(key);
+        std::lock_guard<std::mutex> guard(s.lock);
+        if(s.map.containsKey(key))return 0;
+        s.map.put(key,value);
+        return 1;
+    }
+
+    /**
+     * TODO Replaces the value of a present key by fn(oldValue) atomically.
+     * fn is called while the shard is locked, so it should be short and must not
+     * access this map. Returns true if the key was present.
+     */
+    template <class F>
+    bool computeIfPresent(const K &key, F fn)
+    {
+        Shard &s=getShard(key);
+        std::lock_guard<std::mutex> guard(s.lock);
+        V *value=s.map.find(key);
+        if(!value)return 0;
+        *value=fn(*value);
+        return 1;
+    }
+
+    /**
+     * TODO Removes the mapping for the specified key from this map if present.
+     * If there is no mapping for the specified key, throws ElementNotExist exception.
+     * @throw ElementNotExist
+     */
+    void remove(const K &key)
+    {
+        Shard &s=getShard(key);
+        std::lock_guard<std::mutex> guard(s.lock);
+        s.map.remove(key);
+    }
+
+    /**
+     * TODO Returns the number of key-value mappings in this map.
+     * The shards are counted one by one, so the result is only a snapshot when
+     * other threads are modifying the map.
+     */
+    int size() const
+    {
+        int res=0;
+        for(int i=0;i<shards;++i)
+        {
+            std::lock_guard<std::mutex> guard(shard[i].lock);
+            res+=shard[i].map.size();
+        }
+        return res;
+    }
+private:
+    /**
+     * The padding keeps the locks of neighbouring shards off the same cache line,
+     * so that locking one shard does not invalidate the line of its neighbour.
+     */
+    struct Shard
+    {
+        mutable std::mutex lock;
+        HashMap<K,V,H> map;
+        char pad[64];
+    };
+
+    /**
+     * @param shards the number of the shards, always a power of 2.
+     * @param shard the array which restore the shards.
+     */
+    int shards;
+    Shard *shard;
+
+    /**
+     * TODO choose the shard of the key. The hash code is mixed first, so that the
+     * shard index and the bucket index inside the shard use different bits.
+     */
+    Shard &getShard(const K &key) const
+    {
+        unsigned int h=(unsigned int)H::hashCode(key)*2654435761u;
+        return shard[(h>>16)&(shards-1)];
+    }
+};
+
+#endif
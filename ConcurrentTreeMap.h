@@ -0,0 +1,305 @@
+/** @file */
+#ifndef __CONCURRENTTREEMAP_H
+#define __CONCURRENTTREEMAP_H
+
+#include "TreeMap.h"
+#include "ArrayList.h"
+#include "ElementNotExist.h"
+#include <atomic>
+#include <mutex>
+
+/**
+ * ConcurrentTreeMap is a TreeMap which can be shared between threads, for
+ * indexes read by many threads and written by few.
+ *
+ * The map is a sequence of immutable versions of a persistent TreeMap. A writer
+ * takes the write lock, updates its working copy, which copies only the O(log n)
+ * nodes on the path, and publishes it as the new version with an atomic store.
+ * A reader takes no lock at all: it announces the epoch it starts in, in a slot of
+ * its own on a separate cache line, and reads the current version. So readers
+ * never write to a shared cache line and their throughput scales with the cores.
+ *
+ * A replaced version is freed by a later write once no reader slot announces an
+ * epoch in which it was current (epoch-based reclamation).
+ *
+ * Since the map may change at any time, get() returns the value by copy, and the
+ * iterator goes over a snapshot taken when iterator() is called.
+ */
+template<class K, class V>
+class ConcurrentTreeMap
+{
+public:
+    class Iterator
+    {
+    public:
+        /**
+         * TODO Returns true if the iteration has more elements.
+         */
+        bool hasNext()
+        {
+            return it.hasNext();
+        }
+
+        /**
+         * TODO Returns the next element in the iteration.
+         * @throw ElementNotExist exception when hasNext() == false
+         */
+        const typename TreeMap<K,V>::Entry &next()
+        {
+            return it.next();
+        }
+
+        /**
+         * TODO Constructor
+         */
+        Iterator(const TreeMap<K,V> &_snap):snap(_snap),it(snap.iterator())
+        {
+        }
+    private:
+        TreeMap<K,V> snap;
+        typename TreeMap<K,V>::Iterator it;
+    };
+
+    /**
+     * TODO Constructs an empty map.
+     */
+    ConcurrentTreeMap():current(new TreeMap<K,V>()),epoch(1)
+    {
+        for(int i=0;i<maxReaders;++i)slots[i].active=0;
+    }
+
+    /**
+     * TODO Destructor. No thread may still be using the map.
+     */
+    ~ConcurrentTreeMap()
+    {
+        delete current.load();
+        for(int i=0;i<retired.size();++i)delete retired.get(i).version;
+    }
+
+    ConcurrentTreeMap(const ConcurrentTreeMap &x)=delete;
+    ConcurrentTreeMap &operator=(const ConcurrentTreeMap &x)=delete;
+
+    /**
+     * TODO Returns an iterator over a snapshot of this map.
+     */
+    Iterator iterator() const
+    {
+        return Iterator(snapshot());
+    }
+
+    /**
+     * TODO Returns the current version of this map as a TreeMap, in O(1) time.
+     * It does not change with the later updates, so several queries on it are
+     * consistent with each other.
+     */
+    TreeMap<K,V> snapshot() const
+    {
+        Reader r(this);
+        return *r.version;
+    }
+
+    /**
+     * TODO Removes all of the mappings from this map.
+     */
+    void clear()
+    {
+        std::lock_guard<std::mutex> guard(writer);
+        working.clear();
+        publish();
+    }
+
+    /**
+     * TODO Returns true if this map contains a mapping for the specified key.
+     */
+    bool containsKey(const K &key) const
+    {
+        Reader r(this);
+        return r.version->containsKey(key);
+    }
+
+    /**
+     * TODO Returns true if this map maps one or more keys to the specified value.
+     */
+    bool containsValue(const V &value) const
+    {
+        Reader r(this);
+        return r.version->containsValue(value);
+    }
+
+    /**
+     * TODO Returns a copy of the value to which the specified key is mapped.
+     * If the key is not present in this map, this function should throw ElementNotExist exception.
+     * @throw ElementNotExist
+     */
+    V get(const K &key) const
+    {
+        Reader r(this);
+        return r.version->get(key);
+    }
+
+    /**
+     * TODO Returns true if this map contains no key-value mappings.
+     */
+    bool isEmpty() const
+    {
+        return size()==0;
+    }
+
+    /**
+     * TODO Associates the specified value with the specified key in this map.
+     */
+    void put(const K &key, const V &value)
+    {
+        std::lock_guard<std::mutex> guard(writer);
+        working.put(key,value);
+        publish();
+    }
+
+    /**
+     * TODO Removes the mapping for the specified key from this map if present.
+     * If there is no mapping for the specified key, throws ElementNotExist exception.
+     * @throw ElementNotExist
+     */
+    void remove(const K &key)
+    {
+        std::lock_guard<std::mutex> guard(writer);
+        working.remove(key);
+        publish();
+    }
+
+    /**
+     * TODO Returns the number of key-value mappings in this map.
+     */
+    int size() const
+    {
+        Reader r(this);
+        return r.version->size();
+    }
+
+private:
+    static const int maxReaders=64;
+
+    /**
+     * @param active the epoch in which the reader owning the slot started its
+     * current read, 0 when it is not reading.
+     */
+    struct Slot
+    {
+        std::atomic<unsigned long long> active;
+        char pad[64];
+    };
+
+    struct Retired
+    {
+        TreeMap<K,V> *version;
+        unsigned long long epoch;
+    };
+
+    /**
+     * A thread claims one of the maxReaders slot numbers the first time it reads,
+     * and gives it back when it exits. It uses the same number in every map.
+     * The threads beyond maxReaders get -1 and read under the write lock.
+     */
+    struct Claim
+    {
+        int index;
+
+        Claim():index(-1)
+        {
+            for(int i=0;i<maxReaders;++i)
+            {
+                bool expected=0;
+                if(taken()[i].compare_exchange_strong(expected,1))
+                {
+                    index=i;
+                    break;
+                }
+            }
+        }
+
+        ~Claim()
+        {
+            if(index>=0)taken()[index]=0;
+        }
+    };
+
+    static std::atomic<bool> *taken()
+    {
+        static std::atomic<bool> flags[maxReaders];
+        return flags;
+    }
+
+    static int readerIndex()
+    {
+        static thread_local Claim claim;
+        return claim.index;
+    }
+
+    /**
+     * A read of the current version, which cannot be freed while it lasts.
+     * The epoch is announced before the version is loaded, so a writer which does
+     * not see the announcement has already published a newer version.
+     */
+    struct Reader
+    {
+        const ConcurrentTreeMap *base;
+        int index;
+        const TreeMap<K,V> *version;
+
+        Reader(const ConcurrentTreeMap *c):base(c),index(readerIndex())
+        {
+            if(index<0)base->writer.lock();
+            else base->slots[index].active=base->epoch.load();
+            version=base->current.load();
+        }
+
+        ~Reader()
+        {
+            if(index<0)base->writer.unlock();
+            else base->slots[index].active.store(0,std::memory_order_release);
+        }
+    };
+
+    /**
+     * @param current the version read by the readers.
+     * @param working the version updated by the writers, which shares its nodes
+     * with current.
+     * @param epoch incremented by every publish().
+     * @param retired the replaced versions, with the epoch in which they were
+     * replaced, waiting for their readers.
+     */
+    std::atomic<TreeMap<K,V> *> current;
+    TreeMap<K,V> working;
+    std::atomic<unsigned long long> epoch;
+    mutable std::mutex writer;
+    ArrayList<Retired> retired;
+    mutable Slot slots[maxReaders];
+
+    /**
+     * TODO publish working as the new version and free the versions no reader can
+     * still hold: those replaced before the oldest epoch announced by a reader.
+     */
+    void publish()
+    {
+        Retired old;
+        old.version=current.exchange(new TreeMap<K,V>(working));
+        old.epoch=epoch++;
+        retired.add(old);
+        unsigned long long oldest=epoch.load();
+        for(int i=0;i<maxReaders;++i)
+        {
+            unsigned long long a=slots[i].active.load();
+            if(a && a<oldest)oldest=a;
+        }
+        int kept=0;
+        for(int i=0;i<retired.size();++i)
+        {
+            if(retired.get(i).epoch<oldest)delete retired.get(i).version;
+            else retired.set(kept++,retired.get(i));
+        }
+        while(retired.size()>kept)retired.removeIndex(retired.size()-1);
+    }
+};
+
+#endif
@@ -4,6 +4,9 @@
 #define __HASHMAP_H
 
 #include "ElementNotExist.h"
+#include "HashTable.h"
+
+template <class K, class V, class H> class MappedHashMap;
 
 /**
  * HashMap is a map implemented by hashing. Also, the 'capacity' here means the
@@ -40,8 +43,44 @@
  *
  * The order of iteration could be arbitary in HashMap. But it should be guaranteed
  * that each (key, value) pair be iterated exactly once.
+ *
+ * If H declares a member type named ``is_transparent'', get() and containsKey()
+ * also accept keys of any other type Q, as long as H::hashCode(Q) gives the same
+ * hash code as the equal K and K == Q can be compared. So a std::string-keyed map
+ * can be queried with a const char * without constructing a temporary string:
+ * @code
+ *      class Hashstr {
+ *      public:
+ *          typedef void is_transparent;
+ *          static int hashCode(const std::string &s) { return hashCode(s.c_str()); }
+ *          static int hashCode(const char *s) { int h=0; while(*s)h=h*31+*s++; return h; }
+ *      };
+ * @endcode
+ *
+ * Template argument A is the allocator of the nodes (see Allocator.h). The default
+ * HeapAllocator news and deletes every node. With ArenaAllocator the nodes are
+ * bump-allocated from blocks, and clear() and the destructor free all of them at
+ * once, without walking the buckets when K and V need no destructor:
+ * @code
+ *      HashMap<int, int, Hashint, ArenaAllocator> hash;
+ * @endcode
+ *
+ * stats() describes the shape of the table. When HASHMAP_COUNTERS is defined
+ * before including this file, the map also counts the operations on its hot
+ * paths, which are reported by stats() too; otherwise those counters stay 0 and
+ * cost nothing.
+ *
+ * The buckets are managed by HashTable, which HashSet and HashMultiMap share.
+ *
+ * saveTo() writes the map to a file which MappedHashMap maps back read-only.
+ * MappedHashMap.h must be included to call it, so that the other users of
+ * HashMap do not get the POSIX headers it needs.
+ *
+ * When most lookups are misses, find() and tryGet() avoid the cost of the
+ * ElementNotExist thrown by get(), and setFilter(true) puts a Bloom filter in
+ * front of the buckets which rejects most absent keys without walking a chain.
  */
-template <class K, class V, class H>
+template <class K, class V, class H, template <class> class A=HeapAllocator>
 class HashMap
 {
 public:
@@ -52,11 +91,7 @@ public:
     public:
         Entry(){}
 
-        Entry(K k, V v)
-        {
-            key = k;
-            value = v;
-        }
+        Entry(const K &k, const V &v):key(k),value(v){}
 
         const K &getKey() const
         {
@@ -68,198 +103,162 @@ public:
             return value;
         }
 
-        void modifyValue(V _value)
+        V &getValue()
         {
-            value=_value;
+            return value;
         }
-    };
 
-    class Iterator
-    {
-    public:
-        /**
-         * TODO Returns true if the iteration has more elements.
-         */
-        bool hasNext()
+        void modifyValue(const V &_value)
         {
-            if( (cursor->next!=0))return 1;
-            int start;
-            if(!first && cursor->next==0) start=base->getHashCode(cursor->elem.getKey())+1;else start=0;
-            for(int i=start;i<base->capacity;++i)
-            {
-                if(base->elements[i].next)return 1;
-            }
-            return 0;
+            value=_value;
         }
+    };
 
-        /**
-         * TODO Returns the next element in the iteration.
-         * @throw ElementNotExist exception when hasNext() == false
-         */
-        const Entry &next()
-        {
-            if( (cursor->next!=0))
-            {
-                cursor=cursor->next;
-                first=0;
-                return cursor->elem;
-            }
-            int start;
-            if(!first && cursor->next==0) start=base->getHashCode(cursor->elem.getKey())+1;else start=0;
-            if(first)first=!first;
-            for(int i=start;i<base->capacity;++i)
-            {
-                if(base->elements[i].next)
-                {
-                    cursor=base->elements[i].next;
-                    return cursor->elem;
-                }
-            }
-            throw ElementNotExist();
-        }
+    typedef typename HashTable<K,Entry,H,A>::Iterator Iterator;
+    typedef typename HashTable<K,Entry,H,A>::Stats Stats;
 
-        /**
-         * TODO Constructor
-         */
-        Iterator(const HashMap<K,V,H> *c=0):base(c),cursor(&(c->elements[0])),first(1)
-        {
-        }
-    private:
-        const HashMap<K,V,H> *base;
-        struct HashMap<K,V,H>::Node *cursor;
-        bool first;
-    };
+    /**
+     * TODO Returns an iterator over the elements in this map.
+     */
+    Iterator iterator() const
+    {
+        return table.iterator();
+    }
 
     /**
-     * TODO Constructs an empty hash map.
+     * TODO Removes all of the mappings from this map.
      */
-    HashMap()
+    void clear()
     {
-        capacity=11;
-        amount=0;
-        elements=new Node[capacity];
+        table.clear();
     }
 
     /**
-     * TODO Destructor
+     * TODO Returns true if this map contains a mapping for the specified key.
      */
-    ~HashMap()
+    bool containsKey(const K &key) const
     {
-        clear();
-        delete [] elements;
+        return table.findNode(key)!=0;
     }
 
     /**
-     * TODO Assignment operator
+     * TODO Same as containsKey(const K &), but for a key of another type.
+     * Only available when H is transparent.
      */
-    HashMap &operator=(const HashMap &x)
+    template <class Q, class HH=H, class=typename HH::is_transparent>
+    bool containsKey(const Q &key) const
     {
-        if(&x!=this)
-        {
-            clear();
-            delete [] elements;
-            capacity=x.capacity;
-            elements=new Node[capacity];
-            auto it=x.iterator();
-            while(it.hasNext())
-            {
-                auto temp=it.next();
-                put(temp.getKey(),temp.getValue());
-            }
-        }
-        return *this;
+        return table.findNode(key)!=0;
     }
 
     /**
-     * TODO Copy-constructor
+     * TODO Returns true if this map maps one or more keys to the specified value.
      */
-    HashMap(const HashMap &x)
+    bool containsValue(const V &value) const
     {
-        amount=0;
-        capacity=x.capacity;
-        elements=new Node[capacity];
-        auto it=x.iterator();
+        auto it=table.iterator();
         while(it.hasNext())
         {
-            auto temp=it.next();
-            put(temp.getKey(),temp.getValue());
+            if(it.next().getValue()==value)return 1;
         }
+        return 0;
     }
 
     /**
-     * TODO Returns an iterator over the elements in this map.
+     * TODO Returns a const reference to the value to which the specified key is mapped.
+     * If the key is not present in this map, this function should throw ElementNotExist exception.
+     * @throw ElementNotExist
      */
-    Iterator iterator() const
+    const V &get(const K &key) const
     {
-        return Iterator(this);
+        Node *a=table.findNode(key);
+        if(!a)throw ElementNotExist();
+        return a->elem.getValue();
     }
 
     /**
-     * TODO Removes all of the mappings from this map.
+     * TODO Same as get(const K &), but for a key of another type.
+     * Only available when H is transparent.
+     * @throw ElementNotExist
      */
-    void clear()
+    template <class Q, class HH=H, class=typename HH::is_transparent>
+    const V &get(const Q &key) const
     {
-        Node *a;
-        for(int i=0;i<capacity;++i)
-        {
-            while(elements[i].next)
-            {
-                a=elements[i].next;
-                elements[i].next=elements[i].next->next;
-                delete a;
-            }
-        }
-        amount=0;
+        Node *a=table.findNode(key);
+        if(!a)throw ElementNotExist();
+        return a->elem.getValue();
     }
 
     /**
-     * TODO Returns true if this map contains a mapping for the specified key.
+     * TODO Returns the address of the value to which the specified key is mapped,
+     * or 0 if the key is not present. Unlike get(), a miss costs no exception.
      */
-    bool containsKey(const K &key) const
+    const V *find(const K &key) const
     {
-        int i=getHashCode(key);
-        auto it=elements[i].next;
-        while(it)
-        {
-            if(it->elem.getKey()==key)return 1;
-            it=it->next;
-        }
-        return 0;
+        Node *a=table.findNode(key);
+        return a?&a->elem.getValue():0;
     }
 
     /**
-     * TODO Returns true if this map maps one or more keys to the specified value.
+     * TODO Returns the address of the value to which the specified key is mapped,
+     * or 0 if the key is not present. The value can be modified through it.
      */
-    bool containsValue(const V &value) const
+    V *find(const K &key)
     {
-        for(int i=0;i<capacity;++i)
-        {
-            auto a=elements[i].next;
-            while(a)
-            {
-                if(a->elem.getValue()==value)return 1;
-                a=a->next;
-            }
-        }
-        return 0;
+        Node *a=table.findNode(key);
+        return a?&a->elem.getValue():0;
     }
 
     /**
-     * TODO Returns a const reference to the value to which the specified key is mapped.
-     * If the key is not present in this map, this function should throw ElementNotExist exception.
-     * @throw ElementNotExist
+     * TODO Copies the value to which the specified key is mapped into out.
+     * Returns false, leaving out unchanged, if the key is not present.
      */
-    const V &get(const K &key) const
+    bool tryGet(const K &key, V &out) const
     {
-        int i;
-        i=getHashCode(key);
-        auto it=elements[i].next;
-        while(it)
-        {
-            if(it->elem.getKey()==key)return it->elem.getValue();
-            it=it->next;
-        }
-        throw ElementNotExist();
+        Node *a=table.findNode(key);
+        if(!a)return 0;
+        out=a->elem.getValue();
+        return 1;
+    }
+
+    /**
+     * TODO Returns a reference to the value to which the specified key is mapped.
+     * If the key is not present, a default-constructed value is inserted first.
+     * The reference stays valid until the key is removed, even if the map grows.
+     */
+    V &getOrInsert(const K &key)
+    {
+        Node **link,*a=table.findNode(key,link);
+        if(a)return a->elem.getValue();
+        return table.append(link,key,V())->elem.getValue();
+    }
+
+    /**
+     * TODO Returns a reference to the value to which the specified key is mapped.
+     * If the key is not present, fn(key) is called and its result is inserted.
+     */
+    template <class F>
+    V &computeIfAbsent(const K &key, F fn)
+    {
+        Node **link,*a=table.findNode(key,link);
+        if(a)return a->elem.getValue();
+        return table.append(link,key,fn(key))->elem.getValue();
+    }
+
+    /**
+     * TODO If the key is not present, associates delta with it. Otherwise the value
+     * is replaced by fn(oldValue, delta). Returns a reference to the new value.
+     * For example, merge(key, 1, std::plus<int>()) counts the occurrences of key
+     * with a single lookup.
+     */
+    template <class F>
+    V &merge(const K &key, const V &delta, F fn)
+    {
+        Node **link,*a=table.findNode(key,link);
+        if(!a)return table.append(link,key,delta)->elem.getValue();
+        V &value=a->elem.getValue();
+        value=fn(value,delta);
+        return value;
     }
 
     /**
@@ -267,7 +266,7 @@ public:
      */
     bool isEmpty() const
     {
-        return (amount==0);
+        return table.isEmpty();
     }
 
     /**
@@ -275,21 +274,8 @@ public:
      */
     void put(const K &key, const V &value)
     {
-        int i=getHashCode(key);
-        auto a=elements[i].next,b=&elements[i];
-     	  while(a)
-     	  {
-     	  	if(a->elem.getKey()==key)
-     	  	{
-     	  		a->elem.modifyValue(value);
-     	  		return;
-     	  	}
-     	  	b=a;
-     	  	a=a->next;
-     	  }
-     	  b->next=new Node(Entry(key,value),0);
-        amount++;
-        if(amount>capacity)enlarge();
+        Node **link,*a=table.findNode(key,link);
+        if(a)a->elem.modifyValue(value);else table.append(link,key,value);
     }
 
     /**
@@ -299,21 +285,9 @@ public:
      */
     void remove(const K &key)
     {
-        int i=getHashCode(key);
-     	  auto a=elements[i].next,b=&elements[i];
-     	  while(a)
-     	  {
-     	  	if(a->elem.getKey()==key)
-     	  	{
-     	  		b->next=a->next;
-     	  		delete a;
-     	  		amount--;
-     	  		return;
-     	  	}
-     	  	b=a;
-     	  	a=a->next;
-     	  }
-     	  throw ElementNotExist();
+        Node **link;
+        if(!table.findNode(key,link))throw ElementNotExist();
+        table.erase(link);
     }
 
     /**
@@ -321,62 +295,95 @@ public:
      */
     int size() const
     {
-        return amount;
+        return table.size();
     }
-private:
+
     /**
-     * @param capacity the size of the array.
-     * @param amount the number of the elements of the array.
-     * @param elements the array which restore the elements.
+     * TODO Makes room for n mappings, so that the next puts do not enlarge the table.
      */
-    int capacity,amount;
-    struct Node
+    void reserve(int n)
     {
-        Entry elem;
-        Node *next;
-        Node(Entry _elem=Entry(),Node *_next=0):elem(_elem),next(_next){}
-    };
-    Node *elements;
-
-     int ABS(int x) const
-     {
-         if(x<0)return -x;else return x;
-     }
+        table.reserve(n);
+    }
 
     /**
-     * TODO calculate the corresponding hash code
+     * TODO Associates every (first, second) pair of the range [first, last) in this map.
+     * For forward iterators the table is sized once up front instead of being
+     * enlarged again and again during the insertion.
      */
-    int getHashCode(const K &key) const
+    template <class It>
+    void putAll(It first, It last)
     {
-        K _key=key;
-        return ABS(H::hashCode(_key)) % capacity;
+        table.reserveFor(first,last);
+        for(;first!=last;++first)put(first->first,first->second);
     }
 
     /**
-     * TODO double the size and recalculate the key-value
+     * TODO Looks up the n keys in keys[0..n). out[i] is set to the address of the
+     * value of keys[i], or to 0 if keys[i] is not present. Returns the number of
+     * keys found. The keys are hashed in groups and their buckets are prefetched
+     * before probing, so the cache misses of a group overlap instead of being
+     * paid one after another as with a loop over get().
      */
-    void enlarge()
+    int getBatch(const K *keys, int n, const V **out) const
     {
-        Node *temp=elements,*a;
-        int t_capacity=capacity;
-        capacity=capacity*2+1;
-        amount=0;
-        elements=new Node[capacity];
-        for(int i=0;i<t_capacity;++i)
+        int found=0;
+        table.probeBatch(keys,n,[&](int i,const Node *a)
         {
-            for(a=temp[i].next;a;a=a->next)put(a->elem.getKey(),a->elem.getValue());
-        }
-        for(int i=0;i<t_capacity;++i)
+            out[i]=a?&a->elem.getValue():0;
+            found+=(a!=0);
+        });
+        return found;
+    }
+
+    /**
+     * TODO Same as getBatch(), but only tells whether each key is present.
+     */
+    int containsBatch(const K *keys, int n, bool *out) const
+    {
+        int found=0;
+        table.probeBatch(keys,n,[&](int i,const Node *a)
         {
-            while(temp[i].next)
-            {
-                a=temp[i].next;
-                temp[i].next=temp[i].next->next;
-                delete a;
-            }
-        }
-        delete [] temp;
+            out[i]=(a!=0);
+            found+=(a!=0);
+        });
+        return found;
+    }
+
+    /**
+     * TODO Returns the statistics of this map. It walks every bucket, so it costs
+     * O(capacity) and is meant for monitoring rather than for hot paths.
+     */
+    Stats stats() const
+    {
+        return table.stats();
     }
+
+    /**
+     * TODO Turns on or off the membership filter, which lets lookups of absent
+     * keys return without walking a chain. It is worth it when most lookups miss.
+     */
+    void setFilter(bool on)
+    {
+        table.setFilter(on);
+    }
+
+    /**
+     * TODO Writes this map to the file at path, so that it can be opened by
+     * MappedHashMap without rebuilding it. K and V must be trivially copyable.
+     * Returns false if the file cannot be written. Needs MappedHashMap.h.
+     */
+    bool saveTo(const char *path) const
+    {
+        return MappedHashMap<K,V,H>::save(*this,path);
+    }
+private:
+    typedef typename HashTable<K,Entry,H,A>::Node Node;
+
+    /**
+     * @param table the buckets which restore the entries.
+     */
+    HashTable<K,Entry,H,A> table;
 };
 
 #endif
@@ -0,0 +1,194 @@
+/** @file */
+
+#ifndef __HASHMULTIMAP_H
+#define __HASHMULTIMAP_H
+
+#include "ElementNotExist.h"
+#include "ArrayList.h"
+#include "HashTable.h"
+
+/**
+ * HashMultiMap is a map implemented by hashing in which a key can be mapped to
+ * several values, on the same bucket engine as HashMap. There is one node per
+ * key, and the values of a key are stored contiguously in an ArrayList in the
+ * order they were put, instead of one node per value.
+ *
+ * Template arguments H and A have the same meaning as in HashMap.
+ *
+ * The iterator returns one Entry per key, holding the key and all its values.
+ * The order of iteration could be arbitary, but each key is iterated exactly once.
+ */
+template <class K, class V, class H, template <class> class A=HeapAllocator>
+class HashMultiMap
+{
+public:
+    class Entry
+    {
+        K key;
+        ArrayList<V> values;
+    public:
+        Entry(const K &k):key(k){}
+
+        const K &getKey() const
+        {
+            return key;
+        }
+
+        const ArrayList<V> &getValues() const
+        {
+            return values;
+        }
+
+        ArrayList<V> &getValues()
+        {
+            return values;
+        }
+    };
+
+    typedef typename HashTable<K,Entry,H,A>::Iterator Iterator;
+    typedef typename HashTable<K,Entry,H,A>::Stats Stats;
+
+    /**
+     * TODO Constructs an empty multimap.
+     */
+    HashMultiMap():amount(0)
+    {
+    }
+
+    /**
+     * TODO Returns an iterator over the keys and their values in this multimap.
+     */
+    Iterator iterator() const
+    {
+        return table.iterator();
+    }
+
+    /**
+     * TODO Removes all of the mappings from this multimap.
+     */
+    void clear()
+    {
+        table.clear();
+        amount=0;
+    }
+
+    /**
+     * TODO Returns true if this multimap contains at least one value for the key.
+     */
+    bool containsKey(const K &key) const
+    {
+        return table.findNode(key)!=0;
+    }
+
+    /**
+     * TODO Returns true if this multimap maps the key to the value.
+     */
+    bool containsEntry(const K &key, const V &value) const
+    {
+        Node *a=table.findNode(key);
+        return a && a->elem.getValues().contains(value);
+    }
+
+    /**
+     * TODO Returns the number of values mapped to the key, 0 if the key is not present.
+     */
+    int count(const K &key) const
+    {
+        Node *a=table.findNode(key);
+        return a?a->elem.getValues().size():0;
+    }
+
+    /**
+     * TODO Returns a const reference to the values to which the specified key is mapped.
+     * If the key is not present in this multimap, this function should throw ElementNotExist exception.
+     * @throw ElementNotExist
+     */
+    const ArrayList<V> &get(const K &key) const
+    {
+        Node *a=table.findNode(key);
+        if(!a)throw ElementNotExist();
+        return a->elem.getValues();
+    }
+
+    /**
+     * TODO Returns true if this multimap contains no mappings.
+     */
+    bool isEmpty() const
+    {
+        return (amount==0);
+    }
+
+    /**
+     * TODO Adds the value to the values of the key. The values already mapped to
+     * the key are kept, even if one of them equals value.
+     */
+    void put(const K &key, const V &value)
+    {
+        Node **link,*a=table.findNode(key,link);
+        if(!a)a=table.append(link,key);
+        a->elem.getValues().add(value);
+        amount++;
+    }
+
+    /**
+     * TODO Removes the key and all of its values.
+     * If there is no mapping for the specified key, throws ElementNotExist exception.
+     * @throw ElementNotExist
+     */
+    void remove(const K &key)
+    {
+        Node **link,*a=table.findNode(key,link);
+        if(!a)throw ElementNotExist();
+        amount-=a->elem.getValues().size();
+        table.erase(link);
+    }
+
+    /**
+     * TODO Removes the first occurrence of the value from the values of the key.
+     * The key is removed together with its last value.
+     * Returns true if the value was present.
+     */
+    bool remove(const K &key, const V &value)
+    {
+        Node **link,*a=table.findNode(key,link);
+        if(!a || !a->elem.getValues().remove(value))return 0;
+        amount--;
+        if(a->elem.getValues().isEmpty())table.erase(link);
+        return 1;
+    }
+
+    /**
+     * TODO Returns the number of key-value mappings in this multimap.
+     */
+    int size() const
+    {
+        return amount;
+    }
+
+    /**
+     * TODO Returns the number of distinct keys in this multimap.
+     */
+    int keyCount() const
+    {
+        return table.size();
+    }
+
+    /**
+     * TODO Returns the statistics of the buckets, see HashMap::stats().
+     */
+    Stats stats() const
+    {
+        return table.stats();
+    }
+private:
+    typedef typename HashTable<K,Entry,H,A>::Node Node;
+
+    /**
+     * @param amount the number of the values.
+     * @param table the buckets which restore the keys and their values.
+     */
+    int amount;
+    HashTable<K,Entry,H,A> table;
+};
+
+#endif
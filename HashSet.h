@@ -0,0 +1,193 @@
+/** @file */
+
+#ifndef __HASHSET_H
+#define __HASHSET_H
+
+#include "ElementNotExist.h"
+#include "HashTable.h"
+
+/**
+ * HashSet is a set implemented by hashing, on the same bucket engine as HashMap.
+ * Only the keys are stored, so an entry costs a key and a link, without the value
+ * payload of a HashMap<K, bool, H>.
+ *
+ * Template arguments H and A have the same meaning as in HashMap. If H is
+ * transparent, contains() accepts keys of other types as HashMap::containsKey()
+ * does.
+ *
+ * The order of iteration could be arbitary. But it should be guaranteed that each
+ * key be iterated exactly once.
+ */
+template <class K, class H, template <class> class A=HeapAllocator>
+class HashSet
+{
+public:
+    class Entry
+    {
+        K key;
+    public:
+        Entry(const K &k):key(k){}
+
+        const K &getKey() const
+        {
+            return key;
+        }
+    };
+
+    typedef typename HashTable<K,Entry,H,A>::Stats Stats;
+
+    class Iterator
+    {
+    public:
+        /**
+         * TODO Returns true if the iteration has more elements.
+         */
+        bool hasNext()
+        {
+            return it.hasNext();
+        }
+
+        /**
+         * TODO Returns the next key in the iteration.
+         * @throw ElementNotExist exception when hasNext() == false
+         */
+        const K &next()
+        {
+            return it.next().getKey();
+        }
+
+        /**
+         * TODO Constructor
+         */
+        Iterator(const HashSet<K,H,A> *c=0):it(c->table.iterator())
+        {
+        }
+    private:
+        typename HashTable<K,Entry,H,A>::Iterator it;
+    };
+
+    /**
+     * TODO Returns an iterator over the keys in this set.
+     */
+    Iterator iterator() const
+    {
+        return Iterator(this);
+    }
+
+    /**
+     * TODO Adds the specified key to this set if it is not already present.
+     * Returns true if the key was added.
+     */
+    bool add(const K &key)
+    {
+        Node **link;
+        if(table.findNode(key,link))return 0;
+        table.append(link,key);
+        return 1;
+    }
+
+    /**
+     * TODO Adds every key of the range [first, last) to this set.
+     * For forward iterators the table is sized once up front.
+     */
+    template <class It>
+    void addAll(It first, It last)
+    {
+        table.reserveFor(first,last);
+        for(;first!=last;++first)add(*first);
+    }
+
+    /**
+     * TODO Removes all of the keys from this set.
+     */
+    void clear()
+    {
+        table.clear();
+    }
+
+    /**
+     * TODO Returns true if this set contains the specified key.
+     */
+    bool contains(const K &key) const
+    {
+        return table.findNode(key)!=0;
+    }
+
+    /**
+     * TODO Same as contains(const K &), but for a key of another type.
+     * Only available when H is transparent.
+     */
+    template <class Q, class HH=H, class=typename HH::is_transparent>
+    bool contains(const Q &key) const
+    {
+        return table.findNode(key)!=0;
+    }
+
+    /**
+     * TODO Looks up the n keys in keys[0..n) with prefetching, as HashMap::containsBatch().
+     * Returns the number of keys found.
+     */
+    int containsBatch(const K *keys, int n, bool *out) const
+    {
+        int found=0;
+        table.probeBatch(keys,n,[&](int i,const Node *a)
+        {
+            out[i]=(a!=0);
+            found+=(a!=0);
+        });
+        return found;
+    }
+
+    /**
+     * TODO Returns true if this set contains no keys.
+     */
+    bool isEmpty() const
+    {
+        return table.isEmpty();
+    }
+
+    /**
+     * TODO Removes the specified key from this set if it is present.
+     * Returns true if it was present.
+     */
+    bool remove(const K &key)
+    {
+        Node **link;
+        if(!table.findNode(key,link))return 0;
+        table.erase(link);
+        return 1;
+    }
+
+    /**
+     * TODO Makes room for n keys, so that the next adds do not enlarge the table.
+     */
+    void reserve(int n)
+    {
+        table.reserve(n);
+    }
+
+    /**
+     * TODO Returns the number of keys in this set.
+     */
+    int size() const
+    {
+        return table.size();
+    }
+
+    /**
+     * TODO Returns the statistics of the buckets, see HashMap::stats().
+     */
+    Stats stats() const
+    {
+        return table.stats();
+    }
+private:
+    typedef typename HashTable<K,Entry,H,A>::Node Node;
+
+    /**
+     * @param table the buckets which restore the keys.
+     */
+    HashTable<K,Entry,H,A> table;
+};
+
+#endif
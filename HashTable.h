@@ -0,0 +1,591 @@
+/** @file */
+
+#ifndef __HASHTABLE_H
+#define __HASHTABLE_H
+
+#include "ElementNotExist.h"
+#include "Allocator.h"
+#include <iterator>
+#include <utility>
+#include <type_traits>
+
+#ifdef HASHMAP_COUNTERS
+#define HASHMAP_COUNT(x) (x)
+#else
+#define HASHMAP_COUNT(x)
+#endif
+
+/**
+ * HashTable is the hashing and bucket engine shared by HashMap, HashSet and
+ * HashMultiMap. It stores elements of type E in separately chained buckets.
+ * E should have a method ``getKey'' returning (a reference to) a K, and the
+ * table hashes and compares elements by that key only.
+ *
+ * Template argument H is the hash function, with the same contract as in
+ * HashMap; template argument A is the allocator of the nodes (see Allocator.h).
+ *
+ * The engine does not check for duplicates by itself: a container looks a key
+ * up with findNode(), which also returns the link where a missing key should be
+ * appended, and then calls append() or erase() on that link.
+ *
+ * setFilter(true) maintains a blocked Bloom filter over the hash codes of the
+ * keys (about 16 bits per key, one 64-bit word probed per lookup). A lookup whose
+ * key is rejected by the filter returns at once, without touching the buckets.
+ * Removed keys stay in the filter until it is rebuilt, which happens when the
+ * table grows or when the removals since the last rebuild outnumber the keys.
+ */
+template <class K, class E, class H, template <class> class A=HeapAllocator>
+class HashTable
+{
+public:
+    struct Node
+    {
+        E elem;
+        Node *next;
+        template <class... T>
+        Node(Node *_next,T&&... args):elem(std::forward<T>(args)...),next(_next){}
+    };
+
+    /**
+     * The figures reported by stats().
+     */
+    struct Stats
+    {
+        int size,capacity;
+        double loadFactor;
+        /**
+         * chains[i] is the number of buckets holding i entries, the last one
+         * counts the buckets holding maxChains-1 entries or more.
+         */
+        static const int maxChains=9;
+        int chains[maxChains];
+        int emptyBuckets,longestChain;
+        /**
+         * the average number of nodes compared by a successful lookup. With a good
+         * hash function it is about 1+loadFactor/2.
+         */
+        double averageProbe;
+        int resizes;
+        long long bytes;
+        double bytesPerEntry;
+        /**
+         * The counters of the hot paths, only maintained with HASHMAP_COUNTERS:
+         * the number of lookups (containsKey, get, put, remove...), the nodes compared
+         * by them, the lookups rejected by the filter, the entries inserted and
+         * removed, and the buckets scanned by iterators.
+         */
+        long long lookups,probes,filtered,inserts,removes,scans;
+    };
+
+    class Iterator
+    {
+    public:
+        /**
+         * TODO Returns true if the iteration has more elements.
+         */
+        bool hasNext()
+        {
+            return cursor!=0;
+        }
+
+        /**
+         * TODO Returns the next element in the iteration.
+         * @throw ElementNotExist exception when hasNext() == false
+         */
+        const E &next()
+        {
+            if(!cursor)throw ElementNotExist();
+            Node *a=cursor;
+            advance();
+            return a->elem;
+        }
+
+        /**
+         * TODO Constructor
+         */
+        Iterator(const HashTable<K,E,H,A> *c=0):base(c),bucket(-1),cursor(0)
+        {
+            advance();
+        }
+    private:
+        /**
+         * @param bucket the bucket of cursor.
+         * @param cursor the node which next() returns, found in advance so that
+         * every empty bucket is scanned only once.
+         */
+        const HashTable<K,E,H,A> *base;
+        int bucket;
+        Node *cursor;
+
+        void advance()
+        {
+            if(cursor && cursor->next)
+            {
+                cursor=cursor->next;
+                return;
+            }
+            cursor=0;
+            while(++bucket<base->capacity)
+            {
+                HASHMAP_COUNT(base->counters.scans++);
+                if(base->elements[bucket])
+                {
+                    cursor=base->elements[bucket];
+                    return;
+                }
+            }
+        }
+    };
+
+    /**
+     * TODO Constructs an empty table.
+     */
+    HashTable()
+    {
+        capacity=11;
+        amount=0;
+        resizes=0;
+        elements=new Node*[capacity]();
+        filter=0;
+    }
+
+    /**
+     * TODO Destructor
+     */
+    ~HashTable()
+    {
+        freeNodes();
+        delete [] elements;
+        delete [] filter;
+    }
+
+    /**
+     * TODO Assignment operator
+     */
+    HashTable &operator=(const HashTable &x)
+    {
+        if(&x!=this)
+        {
+            freeNodes();
+            delete [] elements;
+            delete [] filter;
+            copyFrom(x);
+        }
+        return *this;
+    }
+
+    /**
+     * TODO Copy-constructor
+     */
+    HashTable(const HashTable &x)
+    {
+        resizes=0;
+        copyFrom(x);
+    }
+
+    /**
+     * TODO Returns an iterator over the elements in this table.
+     */
+    Iterator iterator() const
+    {
+        return Iterator(this);
+    }
+
+    /**
+     * TODO Removes all of the elements from this table.
+     */
+    void clear()
+    {
+        freeNodes();
+        for(int i=0;i<capacity;++i)elements[i]=0;
+        amount=0;
+        if(filter)
+        {
+            for(int i=0;i<filterWords;++i)filter[i]=0;
+            stale=0;
+        }
+    }
+
+    /**
+     * TODO Returns true if this table contains no elements.
+     */
+    bool isEmpty() const
+    {
+        return (amount==0);
+    }
+
+    /**
+     * TODO Returns the number of elements in this table.
+     */
+    int size() const
+    {
+        return amount;
+    }
+
+    /**
+     * TODO find the node of the key, or return 0 if it is not present.
+     * link is set to the pointer to that node, or to a place in the chain of the
+     * key (its end, or its head when the filter rejected the key) when the key is
+     * not present, so that the caller can erase or append without a second walk.
+     */
+    template <class Q>
+    Node *findNode(const Q &key,Node **&link) const
+    {
+        HASHMAP_COUNT(counters.lookups++);
+        int code=H::hashCode(key);
+        link=&elements[bucketOf(code)];
+        if(filter && !mayContain(code))
+        {
+            HASHMAP_COUNT(counters.filtered++);
+            return 0;
+        }
+        for(;*link;link=&(*link)->next)
+        {
+            HASHMAP_COUNT(counters.probes++);
+            if((*link)->elem.getKey()==key)return *link;
+        }
+        return 0;
+    }
+
+    template <class Q>
+    Node *findNode(const Q &key) const
+    {
+        Node **link;
+        return findNode(key,link);
+    }
+
+    /**
+     * TODO insert a new node built from args at link, which must be in the chain of
+     * its key as returned by findNode(). Returns the new node, which stays at the
+     * same address until it is erased, even if the table grows.
+     */
+    template <class... T>
+    Node *append(Node **link,T&&... args)
+    {
+        Node *a=new (alloc.allocate()) Node(*link,std::forward<T>(args)...);
+        *link=a;
+        amount++;
+        HASHMAP_COUNT(counters.inserts++);
+        if(amount>capacity)enlarge();
+        else if(filter)addToFilter(H::hashCode(a->elem.getKey()));
+        return a;
+    }
+
+    /**
+     * TODO unlink and destroy the node at link, as returned by findNode().
+     */
+    void erase(Node **link)
+    {
+        Node *a=*link;
+        *link=a->next;
+        destroyNode(a);
+        amount--;
+        HASHMAP_COUNT(counters.removes++);
+        if(filter && ++stale>amount+filterWords)buildFilter();
+    }
+
+    /**
+     * TODO Turns the membership filter on or off.
+     */
+    void setFilter(bool on)
+    {
+        delete [] filter;
+        filter=0;
+        if(on)buildFilter();
+    }
+
+    /**
+     * TODO Returns true if the membership filter is on.
+     */
+    bool hasFilter() const
+    {
+        return filter!=0;
+    }
+
+    /**
+     * TODO Makes room for n elements, so that the next appends do not enlarge the table.
+     */
+    void reserve(int n)
+    {
+        if(n<=capacity)return;
+        int c=capacity;
+        while(c<n)c=c*2+1;
+        rehash(c);
+    }
+
+    /**
+     * TODO Makes room for the elements of [first, last) if the range can be measured
+     * without consuming it, that is for forward iterators.
+     */
+    template <class It>
+    void reserveFor(It first,It last)
+    {
+        reserveFor(first,last,typename std::iterator_traits<It>::iterator_category());
+    }
+
+    /**
+     * TODO probe keys[0..n) in groups: hash the whole group and prefetch the buckets,
+     * then read the chain heads and prefetch the first nodes, then walk the chains.
+     * probe(i, node) is called for every key, with node==0 if it is not present.
+     */
+    template <class P>
+    void probeBatch(const K *keys,int n,P probe) const
+    {
+        const int group=16;
+        int index[group];
+        const Node *head[group];
+        for(int s=0;s<n;s+=group)
+        {
+            int m=n-s<group?n-s:group;
+            for(int i=0;i<m;++i)
+            {
+                int code=H::hashCode(keys[s+i]);
+                index[i]=bucketOf(code);
+                if(filter && !mayContain(code))
+                {
+                    HASHMAP_COUNT(counters.filtered++);
+                    index[i]=-1;
+                }else prefetch(&elements[index[i]]);
+            }
+            for(int i=0;i<m;++i)
+            {
+                head[i]=index[i]<0?0:elements[index[i]];
+                if(head[i])prefetch(head[i]);
+            }
+            for(int i=0;i<m;++i)
+            {
+                const Node *a=head[i];
+                HASHMAP_COUNT(counters.lookups++);
+                for(;a;a=a->next)
+                {
+                    HASHMAP_COUNT(counters.probes++);
+                    if(a->elem.getKey()==keys[s+i])break;
+                }
+                probe(s+i,a);
+            }
+        }
+    }
+
+    /**
+     * TODO Returns the statistics of this table. It walks every bucket, so it costs
+     * O(capacity) and is meant for monitoring rather than for hot paths.
+     */
+    Stats stats() const
+    {
+        Stats res;
+        res.size=amount;
+        res.capacity=capacity;
+        res.loadFactor=(double)amount/capacity;
+        for(int i=0;i<Stats::maxChains;++i)res.chains[i]=0;
+        res.longestChain=0;
+        long long probes=0;
+        for(int i=0;i<capacity;++i)
+        {
+            int len=0;
+            for(Node *a=elements[i];a;a=a->next)++len;
+            res.chains[len<Stats::maxChains?len:Stats::maxChains-1]++;
+            if(len>res.longestChain)res.longestChain=len;
+            probes+=(long long)len*(len+1)/2;
+        }
+        res.emptyBuckets=res.chains[0];
+        res.averageProbe=amount?(double)probes/amount:0;
+        res.resizes=resizes;
+        res.bytes=sizeof(*this)+(long long)capacity*sizeof(Node *)+(long long)amount*sizeof(Node);
+        if(filter)res.bytes+=(long long)filterWords*sizeof(unsigned long long);
+        res.bytesPerEntry=amount?(double)res.bytes/amount:0;
+        res.lookups=counters.lookups;
+        res.probes=counters.probes;
+        res.filtered=counters.filtered;
+        res.inserts=counters.inserts;
+        res.removes=counters.removes;
+        res.scans=counters.scans;
+        return res;
+    }
+private:
+    /**
+     * @param capacity the number of the buckets.
+     * @param amount the number of the elements.
+     * @param elements the heads of the chains of the buckets.
+     * @param alloc the allocator of the nodes.
+     * @param resizes the number of times the table was rehashed.
+     * @param counters the counters of the hot paths, see Stats.
+     * @param filter the words of the Bloom filter, 0 when it is off.
+     * @param filterWords the number of the words, a power of 2.
+     * @param stale the number of removals since the filter was built.
+     */
+    int capacity,amount;
+    Node **elements;
+    A<Node> alloc;
+    int resizes;
+    struct Counters
+    {
+        long long lookups,probes,filtered,inserts,removes,scans;
+        Counters():lookups(0),probes(0),filtered(0),inserts(0),removes(0),scans(0){}
+    };
+    mutable Counters counters;
+    unsigned long long *filter;
+    int filterWords,stale;
+
+    /**
+     * TODO calculate the corresponding hash code
+     */
+    template <class Q>
+    int getHashCode(const Q &key) const
+    {
+        return bucketOf(H::hashCode(key));
+    }
+
+    /**
+     * TODO the bucket of a hash code: |code| % capacity, computed without negating
+     * INT_MIN.
+     */
+    int bucketOf(int code) const
+    {
+        return code<0?(int)(-(long long)code%capacity):code%capacity;
+    }
+
+    /**
+     * TODO the bits of a hash code in the filter: a word, and 4 bits in that word.
+     */
+    unsigned long long filterBits(int code,int &word) const
+    {
+        unsigned long long h=(unsigned int)code*0x9E3779B97F4A7C15ULL;
+        h^=h>>32;
+        word=(int)(h>>32)&(filterWords-1);
+        return (1ULL<<(h&63))|(1ULL<<(h>>6&63))|(1ULL<<(h>>12&63))|(1ULL<<(h>>18&63));
+    }
+
+    bool mayContain(int code) const
+    {
+        int word;
+        unsigned long long bits=filterBits(code,word);
+        return (filter[word]&bits)==bits;
+    }
+
+    void addToFilter(int code)
+    {
+        int word;
+        unsigned long long bits=filterBits(code,word);
+        filter[word]|=bits;
+    }
+
+    /**
+     * TODO build the filter again from the keys, with about 16 bits per bucket.
+     */
+    void buildFilter()
+    {
+        delete [] filter;
+        for(filterWords=1;filterWords*4<capacity;filterWords*=2);
+        filter=new unsigned long long[filterWords]();
+        stale=0;
+        for(int i=0;i<capacity;++i)
+            for(Node *a=elements[i];a;a=a->next)addToFilter(H::hashCode(a->elem.getKey()));
+    }
+
+    void destroyNode(Node *a)
+    {
+        a->~Node();
+        alloc.deallocate(a);
+    }
+
+    /**
+     * TODO destroy every node and give the memory back, leaving the buckets
+     * dangling. With a bulk allocator and trivially destructible nodes, only the
+     * blocks of the allocator are freed.
+     */
+    void freeNodes()
+    {
+        if(!A<Node>::bulk || !std::is_trivially_destructible<Node>::value)
+            for(int i=0;i<capacity;++i)
+                for(Node *a=elements[i],*b;a;a=b)
+                {
+                    b=a->next;
+                    destroyNode(a);
+                }
+        alloc.release();
+    }
+
+    /**
+     * TODO copy the buckets of x, keeping the order of every chain.
+     */
+    void copyFrom(const HashTable &x)
+    {
+        capacity=x.capacity;
+        amount=x.amount;
+        elements=new Node*[capacity];
+        filter=0;
+        if(x.filter)
+        {
+            filterWords=x.filterWords;
+            stale=x.stale;
+            filter=new unsigned long long[filterWords];
+            for(int i=0;i<filterWords;++i)filter[i]=x.filter[i];
+        }
+        for(int i=0;i<capacity;++i)
+        {
+            Node **link=&elements[i];
+            for(Node *a=x.elements[i];a;a=a->next)
+            {
+                *link=new (alloc.allocate()) Node(0,a->elem);
+                link=&(*link)->next;
+            }
+            *link=0;
+        }
+    }
+
+    /**
+     * TODO double the size and move the nodes into the new buckets.
+     */
+    void enlarge()
+    {
+        rehash(capacity*2+1);
+    }
+
+    /**
+     * TODO move the nodes into n_capacity new buckets.
+     * The nodes are relinked rather than copied, so references to the elements stay valid.
+     */
+    void rehash(int n_capacity)
+    {
+        Node **temp=elements,*a;
+        int t_capacity=capacity;
+        capacity=n_capacity;
+        resizes++;
+        elements=new Node*[capacity]();
+        for(int i=0;i<t_capacity;++i)
+        {
+            while(temp[i])
+            {
+                a=temp[i];
+                temp[i]=a->next;
+                Node *&bucket=elements[getHashCode(a->elem.getKey())];
+                a->next=bucket;
+                bucket=a;
+            }
+        }
+        delete [] temp;
+        if(filter)buildFilter();
+    }
+
+    template <class It>
+    void reserveFor(It first,It last,std::forward_iterator_tag)
+    {
+        reserve(amount+(int)std::distance(first,last));
+    }
+
+    template <class It>
+    void reserveFor(It,It,std::input_iterator_tag)
+    {
+    }
+
+    static void prefetch(const void *p)
+    {
+#ifdef __GNUC__
+        __builtin_prefetch(p);
+#endif
+    }
+};
+
+#undef HASHMAP_COUNT
+
+#endif
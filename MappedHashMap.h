@@ -0,0 +1,315 @@
+/** @file */
+
+#ifndef __MAPPEDHASHMAP_H
+#define __MAPPEDHASHMAP_H
+
+#include "ElementNotExist.h"
+#include <cstdio>
+#include <cstring>
+#include <type_traits>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+
+/**
+ * MappedHashMap is a read-only hash map over a file written by HashMap::saveTo().
+ * The file is a flat table without any pointer, so open() only maps it into memory
+ * and the map can be queried at once, without rebuilding anything:
+ * @code
+ *      HashMap<int, int, Hashint> hash;
+ *      ...
+ *      hash.saveTo("table.bin");
+ *
+ *      MappedHashMap<int, int, Hashint> mapped;
+ *      if(mapped.open("table.bin"))
+ *          std::cout << mapped.get(42) << std::endl;
+ * @endcode
+ * get() and containsKey() behave as in HashMap, and the same hash function H must
+ * be used to write and to read a file.
+ *
+ * As the entries are copied byte by byte, K and V must be trivially copyable
+ * (no std::string, no pointer into the memory of the process...).
+ *
+ * The file holds a header, then the first entry of every bucket as an array of
+ * capacity+1 ints, then the entries themselves sorted by bucket, so that a chain
+ * is a contiguous run of entries.
+ */
+template <class K, class V, class H>
+class MappedHashMap
+{
+public:
+    class Entry
+    {
+        K key;
+        V value;
+    public:
+        const K &getKey() const
+        {
+            return key;
+        }
+
+        const V &getValue() const
+        {
+            return value;
+        }
+
+        friend class MappedHashMap<K,V,H>;
+    };
+
+    class Iterator
+    {
+    public:
+        /**
+         * TODO Returns true if the iteration has more elements.
+         */
+        bool hasNext()
+        {
+            return cursor<base->amount;
+        }
+
+        /**
+         * TODO Returns the next element in the iteration.
+         * @throw ElementNotExist exception when hasNext() == false
+         */
+        const Entry &next()
+        {
+            if(!hasNext())throw ElementNotExist();
+            return base->entries[cursor++];
+        }
+
+        /**
+         * TODO Constructor
+         */
+        Iterator(const MappedHashMap<K,V,H> *c=0):base(c),cursor(0)
+        {
+        }
+    private:
+        const MappedHashMap<K,V,H> *base;
+        int cursor;
+    };
+
+    /**
+     * TODO Constructs a map which is not opened yet, and is empty.
+     */
+    MappedHashMap():data(0),length(0),capacity(0),amount(0),start(0),entries(0)
+    {
+    }
+
+    /**
+     * TODO Destructor
+     */
+    ~MappedHashMap()
+    {
+        close();
+    }
+
+    MappedHashMap(const MappedHashMap &x)=delete;
+    MappedHashMap &operator=(const MappedHashMap &x)=delete;
+
+    /**
+     * TODO Maps the file at path. Returns false if it cannot be mapped or was not
+     * written for this K and V, in which case the map is left empty.
+     * The bucket table is checked in one pass, so a damaged file cannot make a
+     * lookup read outside of the entries.
+     */
+    bool open(const char *path)
+    {
+        close();
+        int fd=::open(path,O_RDONLY);
+        if(fd<0)return 0;
+        struct stat st;
+        if(fstat(fd,&st)<0 || st.st_size<(off_t)sizeof(Header))
+        {
+            ::close(fd);
+            return 0;
+        }
+        void *p=mmap(0,st.st_size,PROT_READ,MAP_SHARED,fd,0);
+        ::close(fd);
+        if(p==MAP_FAILED)return 0;
+        data=static_cast<const char *>(p);
+        length=st.st_size;
+        const Header *h=reinterpret_cast<const Header *>(data);
+        if(memcmp(h->magic,magic(),sizeof(h->magic)) || h->entrySize!=sizeof(Entry) ||
+           h->keySize!=sizeof(K) || h->valueSize!=sizeof(V) || h->capacity<=0 ||
+           h->amount<0 || h->entriesOffset<(long long)(sizeof(Header)+(h->capacity+1LL)*sizeof(int)) ||
+           h->entriesOffset+(long long)(h->amount*sizeof(Entry))>length)
+        {
+            close();
+            return 0;
+        }
+        const int *table=reinterpret_cast<const int *>(data+sizeof(Header));
+        bool sorted=(table[0]==0 && table[h->capacity]==h->amount);
+        for(int i=0;sorted && i<h->capacity;++i)sorted=(table[i]<=table[i+1]);
+        if(!sorted)
+        {
+            close();
+            return 0;
+        }
+        capacity=h->capacity;
+        amount=h->amount;
+        start=table;
+        entries=reinterpret_cast<const Entry *>(data+h->entriesOffset);
+        return 1;
+    }
+
+    /**
+     * TODO Unmaps the file. The map becomes empty.
+     */
+    void close()
+    {
+        if(data)munmap(const_cast<char *>(data),length);
+        data=0;
+        length=0;
+        capacity=amount=0;
+        start=0;
+        entries=0;
+    }
+
+    /**
+     * TODO Returns an iterator over the elements in this map.
+     */
+    Iterator iterator() const
+    {
+        return Iterator(this);
+    }
+
+    /**
+     * TODO Returns true if this map contains a mapping for the specified key.
+     */
+    bool containsKey(const K &key) const
+    {
+        return find(key)!=0;
+    }
+
+    /**
+     * TODO Returns a const reference to the value to which the specified key is mapped.
+     * If the key is not present in this map, this function should throw ElementNotExist exception.
+     * @throw ElementNotExist
+     */
+    const V &get(const K &key) const
+    {
+        const Entry *a=find(key);
+        if(!a)throw ElementNotExist();
+        return a->value;
+    }
+
+    /**
+     * TODO Returns true if this map contains no key-value mappings.
+     */
+    bool isEmpty() const
+    {
+        return (amount==0);
+    }
+
+    /**
+     * TODO Returns the number of key-value mappings in this map.
+     */
+    int size() const
+    {
+        return amount;
+    }
+
+    /**
+     * TODO Writes the entries of map, which has an iterator over entries with
+     * getKey() and getValue() (such as HashMap), to the file at path in the format
+     * read by open(). Returns false if the file cannot be written.
+     */
+    template <class M>
+    static bool save(const M &map, const char *path)
+    {
+        static_assert(std::is_trivially_copyable<K>::value && std::is_trivially_copyable<V>::value,
+                      "MappedHashMap only stores trivially copyable keys and values");
+        Header h;
+        memset(&h,0,sizeof(h));
+        memcpy(h.magic,magic(),sizeof(h.magic));
+        h.entrySize=sizeof(Entry);
+        h.keySize=sizeof(K);
+        h.valueSize=sizeof(V);
+        h.amount=map.size();
+        h.capacity=h.amount/2*2+1;
+        long long offset=sizeof(Header)+(long long)(h.capacity+1)*sizeof(int);
+        h.entriesOffset=(offset+15)/16*16;
+
+        int *first=new int[h.capacity+1]();
+        auto it=map.iterator();
+        while(it.hasNext())first[getHashCode(it.next().getKey(),h.capacity)+1]++;
+        for(int i=0;i<h.capacity;++i)first[i+1]+=first[i];
+        Entry *e=new Entry[h.amount>0?h.amount:1];
+        memset(static_cast<void *>(e),0,(h.amount>0?h.amount:1)*sizeof(Entry));
+        int *fill=new int[h.capacity];
+        memcpy(fill,first,h.capacity*sizeof(int));
+        it=map.iterator();
+        while(it.hasNext())
+        {
+            const auto &a=it.next();
+            Entry &b=e[fill[getHashCode(a.getKey(),h.capacity)]++];
+            b.key=a.getKey();
+            b.value=a.getValue();
+        }
+
+        FILE *f=fopen(path,"wb");
+        bool ok=(f!=0);
+        if(ok)
+        {
+            char pad[16]={0};
+            ok=fwrite(&h,sizeof(h),1,f)==1 &&
+               fwrite(first,sizeof(int),h.capacity+1,f)==(size_t)h.capacity+1 &&
+               fwrite(pad,1,h.entriesOffset-offset,f)==(size_t)(h.entriesOffset-offset) &&
+               fwrite(e,sizeof(Entry),h.amount,f)==(size_t)h.amount;
+            ok=(fclose(f)==0) && ok;
+        }
+        delete [] first;
+        delete [] fill;
+        delete [] e;
+        return ok;
+    }
+private:
+    struct Header
+    {
+        char magic[8];
+        int entrySize,keySize,valueSize;
+        int capacity,amount;
+        long long entriesOffset;
+    };
+
+    /**
+     * @param data the mapped file.
+     * @param length the length of the file.
+     * @param capacity the number of the buckets.
+     * @param amount the number of the entries.
+     * @param start start[i] is the first entry of bucket i, start[capacity] is amount.
+     * @param entries the entries, sorted by bucket.
+     */
+    const char *data;
+    long long length;
+    int capacity,amount;
+    const int *start;
+    const Entry *entries;
+
+    static const char *magic()
+    {
+        return "DSHMAP1";
+    }
+
+    /**
+     * TODO calculate the corresponding hash code: |code| % capacity, computed
+     * without negating INT_MIN.
+     */
+    static int getHashCode(const K &key,int capacity)
+    {
+        int code=H::hashCode(key);
+        return code<0?(int)(-(long long)code%capacity):code%capacity;
+    }
+
+    const Entry *find(const K &key) const
+    {
+        if(!amount)return 0;
+        int i=getHashCode(key,capacity);
+        for(const Entry *a=entries+start[i],*b=entries+start[i+1];a!=b;++a)
+            if(a->key==key)return a;
+        return 0;
+    }
+};
+
+#endif
@@ -0,0 +1,166 @@
+/** @file */
+#ifndef __MONOTONEPRIORITYQUEUE_H
+#define __MONOTONEPRIORITYQUEUE_H
+
+#include "ArrayList.h"
+#include "ElementNotExist.h"
+#include <cassert>
+#include <type_traits>
+
+/**
+ * This is a priority queue of unsigned integer keys for the monotone case: a key
+ * pushed is never less than the last key returned by front() or popped, as with
+ * timers or with Dijkstra's algorithm on non-negative integer weights. The head
+ * is the least key. A payload can be packed into the low bits of the key.
+ *
+ * It is a radix heap. Bucket i > 0 holds the keys whose highest bit differing
+ * from that last key is bit i-1, and the keys equal to it are only counted.
+ * push() appends a key to its bucket in O(1) time. When the keys equal to the
+ * last one run out, the first non-empty bucket is redistributed around its least
+ * key, and every key moves to a lower bucket, so a key moves at most once per
+ * bit and pop() takes O(log C) amortized time, C being the range of the keys.
+ *
+ * Pushing a key less than the last one into a non-empty queue is checked by
+ * assert(), so only in debug builds.
+ */
+template <class K = unsigned long long>
+class MonotonePriorityQueue
+{
+    static_assert(std::is_unsigned<K>::value && sizeof(K)<=sizeof(unsigned long long),
+                  "MonotonePriorityQueue needs an unsigned integer key");
+public:
+    /**
+     * TODO Constructs an empty priority queue.
+     */
+    MonotonePriorityQueue():last(0),equal(0),amount(0),used(0)
+    {
+    }
+
+    /**
+     * TODO Removes all of the elements from this priority queue. The next key
+     * pushed may be any key.
+     */
+    void clear()
+    {
+        for(int i=1;i<=bits;++i)buckets[i].clear();
+        last=0;
+        equal=amount=0;
+        used=0;
+    }
+
+    /**
+     * TODO Returns a const reference to the front of the priority queue.
+     * If there are no elements, this function should throw ElementNotExist exception.
+     * @throw ElementNotExist
+     */
+    const K &front() const
+    {
+        if(empty())throw ElementNotExist();
+        settle();
+        return last;
+    }
+
+    /**
+     * TODO Returns true if this PriorityQueue contains no elements.
+     */
+    bool empty() const
+    {
+        return amount==0;
+    }
+
+    /**
+     * TODO Returns the number of elements in this priority queue.
+     */
+    int size() const
+    {
+        return amount;
+    }
+
+    /**
+     * TODO Add a key to the priority queue. Unless the queue is empty, it must not
+     * be less than the last key returned by front() or popped.
+     */
+    void push(const K &key)
+    {
+        assert((!amount || !(key<last)) && "MonotonePriorityQueue::push() of a key less than the last one");
+        if(!amount && key<last)last=key;
+        amount++;
+        if(key==last)
+        {
+            equal++;
+            return;
+        }
+        int i=bucketOf(key);
+        buckets[i].add(key);
+        used|=1ULL<<(i-1);
+    }
+
+    /**
+     * TODO Removes the top element of this priority queue if present.
+     * If there is no element, throws ElementNotExist exception.
+     * @throw ElementNotExist
+     */
+    void pop()
+    {
+        if(empty())throw ElementNotExist();
+        settle();
+        amount--;
+        equal--;
+    }
+
+private:
+    static const int bits=sizeof(K)*8;
+
+    /**
+     * @param last the last key returned by front() or popped, or a lower key
+     * pushed into the empty queue.
+     * @param equal the number of keys equal to last.
+     * @param used bit i-1 is set when buckets[i] is not empty.
+     * @param buckets buckets[0] is not used.
+     * They change in front(), which moves the least key into last.
+     */
+    mutable K last;
+    mutable int equal;
+    int amount;
+    mutable unsigned long long used;
+    mutable ArrayList<K> buckets[bits+1];
+
+    /**
+     * TODO Returns the bucket of a key different from last: one more than its
+     * highest bit differing from last.
+     */
+    int bucketOf(const K &key) const
+    {
+        return 64-__builtin_clzll((unsigned long long)(key^last));
+    }
+
+    /**
+     * TODO if no key is equal to last, make the least key the last one, and move
+     * the keys of its bucket to the buckets around it.
+     */
+    void settle() const
+    {
+        if(equal)return;
+        int i=__builtin_ctzll(used)+1;
+        ArrayList<K> &b=buckets[i];
+        K least=b.get(0);
+        for(int j=1;j<b.size();++j)
+            if(b.get(j)<least)least=b.get(j);
+        last=least;
+        used&=~(1ULL<<(i-1));
+        for(int j=0;j<b.size();++j)
+        {
+            K key=b.get(j);
+            if(key==last)equal++;
+            else
+            {
+                int k=bucketOf(key);
+                buckets[k].add(key);
+                used|=1ULL<<(k-1);
+            }
+        }
+        b.clear();
+    }
+};
+
+#endif
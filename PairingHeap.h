@@ -0,0 +1,400 @@
+/** @file */
+#ifndef __PAIRINGHEAP_H
+#define __PAIRINGHEAP_H
+
+#include "PriorityQueue.h"
+#include "ArrayList.h"
+#include "ElementNotExist.h"
+#include <utility>
+
+/**
+ * This is a priority queue based on a pairing heap, ordered like PriorityQueue
+ * by operator< or by a Comparator C, the head being the least element.
+ *
+ * Every element is a node of a tree in which a node is not greater than its
+ * children. push() and meld() only link two trees, in O(1) time, and so does
+ * decreaseKey() once the node is cut from its parent. pop() pairs the children
+ * of the root two by two from the left, and then links the pairs from the right,
+ * in O(log n) amortized time.
+ *
+ * push() returns a handle of the element, which stays valid until the element
+ * leaves the heap, even if the heap is melded into another one.
+ * The iterator does not return the elements in any particular order.
+ * But it is required that the iterator will eventually return every
+ * element in this heap (even if removals are performed).
+ */
+template <class V, class C = Less<V> >
+class PairingHeap
+{
+private:
+    struct Node;
+public:
+    typedef Node *Handle;
+
+    class Iterator
+    {
+    public:
+        /**
+         * TODO Returns true if the iteration has more elements.
+         */
+        bool hasNext()
+        {
+            return cursor<nodes.size();
+        }
+
+        /**
+         * TODO Returns the next element in the iteration.
+         * @throw ElementNotExist exception when hasNext() == false
+         */
+        const V &next()
+        {
+            if(!hasNext())throw ElementNotExist();
+            valid=1;
+            return nodes.get(cursor++)->value;
+        }
+
+        /**
+         * TODO Removes from the underlying collection the last element
+         * returned by the iterator.
+         * The behavior of an iterator is unspecified if the underlying
+         * collection is modified while the iteration is in progress in
+         * any way other than by calling this method.
+         * @throw ElementNotExist
+         */
+        void remove()
+        {
+            if(!valid)throw ElementNotExist();
+            base->erase(nodes.get(cursor-1));
+            valid=0;
+        }
+
+        /**
+         * TODO Constructor
+         */
+        Iterator(PairingHeap<V,C> *c=0):base(c),cursor(0),valid(0)
+        {
+            base->collect(nodes);
+        }
+    private:
+        /**
+         * @param nodes the nodes of the heap when the iteration began. Removing
+         * one of them does not move the others.
+         * @param valid iterator is invalid when executes remove()
+         */
+        PairingHeap<V,C> *base;
+        ArrayList<Node *> nodes;
+        int cursor;
+        bool valid;
+    };
+
+    /**
+     * TODO Constructs an empty heap.
+     */
+    PairingHeap():root(0),amount(0)
+    {
+    }
+
+    /**
+     * TODO Destructor
+     */
+    ~PairingHeap()
+    {
+        clear();
+    }
+
+    /**
+     * TODO Copy-constructor. The handles of x do not refer to the copy.
+     */
+    PairingHeap(const PairingHeap &x):root(0),amount(0)
+    {
+        copyFrom(x);
+    }
+
+    /**
+     * TODO Assignment operator
+     */
+    PairingHeap &operator=(const PairingHeap &x)
+    {
+        if(&x!=this)
+        {
+            clear();
+            copyFrom(x);
+        }
+        return *this;
+    }
+
+    /**
+     * TODO Returns an iterator over the elements in this heap.
+     */
+    Iterator iterator()
+    {
+        return Iterator(this);
+    }
+
+    /**
+     * TODO Removes all of the elements from this heap.
+     * The tree is flattened by rotations as it is freed, so it takes no stack.
+     */
+    void clear()
+    {
+        Node *x=root;
+        while(x)
+        {
+            if(x->child)
+            {
+                Node *c=x->child;
+                x->child=c->sibling;
+                c->sibling=x;
+                x=c;
+            }else
+            {
+                Node *next=x->sibling;
+                delete x;
+                x=next;
+            }
+        }
+        root=0;
+        amount=0;
+    }
+
+    /**
+     * TODO Returns a const reference to the front of the heap.
+     * If there are no elements, this function should throw ElementNotExist exception.
+     * @throw ElementNotExist
+     */
+    const V &front() const
+    {
+        if(empty())throw ElementNotExist();
+        return root->value;
+    }
+
+    /**
+     * TODO Returns true if this heap contains no elements.
+     */
+    bool empty() const
+    {
+        return amount==0;
+    }
+
+    /**
+     * TODO Returns the number of elements in this heap.
+     */
+    int size() const
+    {
+        return amount;
+    }
+
+    /**
+     * TODO Add an element to the heap, in O(1) time.
+     * Returns the handle of the element.
+     */
+    Handle push(const V &value)
+    {
+        Node *x=new Node(value);
+        root=root?link(root,x):x;
+        amount++;
+        return x;
+    }
+
+    /**
+     * TODO Removes the top element of this heap if present.
+     * If there is no element, throws ElementNotExist exception.
+     * @throw ElementNotExist
+     */
+    void pop()
+    {
+        if(empty())throw ElementNotExist();
+        Node *x=root;
+        root=pairUp(x->child);
+        delete x;
+        amount--;
+    }
+
+    /**
+     * TODO Moves all of the elements of x into this heap in O(1) time, and leaves x
+     * empty. The handles of both heaps refer to the elements in this heap.
+     */
+    void meld(PairingHeap &&x)
+    {
+        if(&x==this || !x.root)return;
+        root=root?link(root,x.root):x.root;
+        amount+=x.amount;
+        x.root=0;
+        x.amount=0;
+    }
+
+    /**
+     * TODO Returns a const reference to the element of the handle.
+     * @throw ElementNotExist
+     */
+    const V &get(Handle h) const
+    {
+        if(!h)throw ElementNotExist();
+        return h->value;
+    }
+
+    /**
+     * TODO Replaces the element of the handle with value if value is less than it,
+     * in O(1) amortized time. Returns true if it did.
+     * @throw ElementNotExist
+     */
+    bool decreaseKey(Handle h, const V &value)
+    {
+        if(!h)throw ElementNotExist();
+        if(!cmp(value,h->value))return 0;
+        h->value=value;
+        if(h!=root)
+        {
+            cut(h);
+            root=link(root,h);
+        }
+        return 1;
+    }
+
+    /**
+     * TODO Replaces the element of the handle with value.
+     * A greater value takes the node out of the tree, children and all, and links
+     * it back alone, in O(log n) amortized time.
+     * @throw ElementNotExist
+     */
+    void update(Handle h, const V &value)
+    {
+        if(!h)throw ElementNotExist();
+        if(cmp(value,h->value))
+        {
+            decreaseKey(h,value);
+            return;
+        }
+        h->value=value;
+        detach(h);
+        root=root?link(root,h):h;
+    }
+
+    /**
+     * TODO Removes the element of the handle, in O(log n) amortized time.
+     * @throw ElementNotExist
+     */
+    void erase(Handle h)
+    {
+        if(!h)throw ElementNotExist();
+        detach(h);
+        delete h;
+        amount--;
+    }
+
+private:
+    /**
+     * A node of the tree.
+     * @param child the first child.
+     * @param sibling the next child of the same parent.
+     * @param prev the previous child of the same parent, or the parent for the
+     * first child.
+     */
+    struct Node
+    {
+        V value;
+        Node *child,*sibling,*prev;
+
+        Node(const V &_value):value(_value),child(0),sibling(0),prev(0)
+        {
+        }
+    };
+
+    Node *root;
+    int amount;
+    C cmp;
+
+    /**
+     * TODO link two trees and return the root of the result, the greater root
+     * becoming the first child of the other one.
+     */
+    Node *link(Node *a, Node *b)
+    {
+        if(cmp(b->value,a->value))std::swap(a,b);
+        b->sibling=a->child;
+        if(a->child)a->child->prev=b;
+        b->prev=a;
+        a->child=b;
+        a->sibling=a->prev=0;
+        return a;
+    }
+
+    /**
+     * TODO cut the node, with its subtree, from its parent.
+     */
+    void cut(Node *x)
+    {
+        if(x->prev->child==x)x->prev->child=x->sibling;
+        else x->prev->sibling=x->sibling;
+        if(x->sibling)x->sibling->prev=x->prev;
+        x->sibling=x->prev=0;
+    }
+
+    /**
+     * TODO take the node out of the tree and link its children back in its place.
+     */
+    void detach(Node *x)
+    {
+        Node *rest=pairUp(x->child);
+        x->child=0;
+        if(x==root)root=rest;
+        else
+        {
+            cut(x);
+            if(rest)root=link(root,rest);
+        }
+    }
+
+    /**
+     * TODO link the list of siblings from first into one tree: link them two by
+     * two from the left, then link the pairs from the right. Returns the root.
+     */
+    Node *pairUp(Node *first)
+    {
+        Node *pairs=0;
+        while(first)
+        {
+            Node *a=first,*b=a->sibling;
+            if(!b)
+            {
+                a->sibling=pairs;
+                pairs=a;
+                break;
+            }
+            first=b->sibling;
+            a=link(a,b);
+            a->sibling=pairs;
+            pairs=a;
+        }
+        if(!pairs)return 0;
+        Node *res=pairs;
+        pairs=pairs->sibling;
+        while(pairs)
+        {
+            Node *next=pairs->sibling;
+            res=link(res,pairs);
+            pairs=next;
+        }
+        res->sibling=res->prev=0;
+        return res;
+    }
+
+    /**
+     * TODO append every node of the heap to nodes.
+     */
+    void collect(ArrayList<Node *> &nodes) const
+    {
+        if(root)nodes.add(root);
+        for(int i=0;i<nodes.size();++i)
+            for(Node *c=nodes.get(i)->child;c;c=c->sibling)nodes.add(c);
+    }
+
+    void copyFrom(const PairingHeap &x)
+    {
+        ArrayList<Node *> nodes;
+        x.collect(nodes);
+        for(int i=0;i<nodes.size();++i)push(nodes.get(i)->value);
+    }
+};
+
+#endif
@@ -6,6 +6,7 @@
 #include "ElementNotExist.h"
 #include "iostream"
 #include <algorithm>
+#include <utility>
 
 /**
  * This is a priority queue based on a priority priority queue. The
@@ -14,6 +15,15 @@
  * second template parameter.
  * The head of this queue is the least element with respect to the
  * specified ordering (different from C++ STL).
+ * The heap is d-ary, D children per node (4 by default), which halves the
+ * depth of a binary heap, so a pop touches fewer cache lines. Every slot of the
+ * heap holds an element together with its id, and sifting moves the elements
+ * into a hole instead of swapping them, so one step writes one slot and one
+ * position.
+ * push() returns a handle of the element, which stays valid until the element
+ * leaves the queue, so its priority can be changed or it can be erased in
+ * O(log n) time. A handle is an index to the id of the element, and ids are
+ * kept 0..size()-1 for the iterator.
  * The iterator does not return the elements in any particular order.
  * But it is required that the iterator will eventually return every
  * element in this queue (even if removals are performed).
@@ -41,10 +51,13 @@ public:
 
 /*----------------------------------------------------------------------*/
 
-template <class V, class C = Less<V> >
+template <class V, class C = Less<V>, int D = 4>
 class PriorityQueue
 {
+    static_assert(D>=2,"PriorityQueue needs at least 2 children per node");
 public:
+    typedef int Handle;
+
     class Iterator
     {
     public:
@@ -53,7 +66,7 @@ public:
          */
         bool hasNext()
         {
-            return cursor-1>0;
+            return cursor>0;
         }
 
         /**
@@ -65,7 +78,7 @@ public:
             if(!hasNext())throw ElementNotExist();
             valid=1;
             cursor--;
-            return base->elements[base->point2[cursor]];
+            return base->heap[base->pos[cursor]].value;
         }
 
 		/**
@@ -79,32 +92,24 @@ public:
 		void remove()
 		{
 		    if(!valid)throw ElementNotExist();
-		    int p1=base->point2[cursor],p2=base->amount;
-            std::swap(base->elements[p1],base->elements[p2]);
-            std::swap(base->point2[base->point1[p1]],base->point2[base->point1[p2]]);
-            std::swap(base->point1[p1],base->point1[p2]);
-            base->point1[base->point2[base->amount]]=cursor;
-            base->point2[cursor]=base->point2[base->amount];
-            base->amount--;
-            base->up(p1);
-            base->down(p1);
+		    base->removeId(cursor);
             valid=0;
 		}
 
 		/**
          * TODO Constructor
          */
-        Iterator(PriorityQueue<V,C> *c=0):base(c)
+        Iterator(PriorityQueue<V,C,D> *c=0):base(c)
         {
-            cursor=base->amount+1;
+            cursor=base->amount;
             valid=0;
         }
     private:
         /**
-         * @param cursor point to the position
+         * @param cursor the ids below cursor are not returned yet.
          * @param valid iterator is invalid when executes remove()
          */
-        PriorityQueue<V,C> *base;
+        PriorityQueue<V,C,D> *base;
         int cursor;
         bool valid;
     };
@@ -116,9 +121,11 @@ public:
     {
         capacity=8;
         amount=0;
-        elements=new V[capacity];
-        point1=new int[capacity];
-        point2=new int[capacity];
+        handles=0;
+        spare=-1;
+        heap=new Slot[capacity];
+        pos=new int[capacity];
+        idOf=new int[capacity];
     }
 
     /**
@@ -126,9 +133,9 @@ public:
      */
     ~PriorityQueue()
     {
-        delete [] elements;
-        delete [] point1;
-        delete [] point2;
+        delete [] heap;
+        delete [] pos;
+        delete [] idOf;
     }
 
     /**
@@ -138,16 +145,10 @@ public:
     {
         if(&x!=this)
         {
-            amount=x.amount;
-            capacity=x.capacity;
-            delete [] elements;
-            delete [] point1;
-            delete [] point2;
-            elements=new V[capacity];
-            point1=new int[capacity];
-            point2=new int[capacity];
-            for(int i=1;i<=amount;++i)elements[i]=x.elements[i];
-            for(int i=1;i<=amount;++i)point1[i]=point2[i]=i;
+            delete [] heap;
+            delete [] pos;
+            delete [] idOf;
+            copyFrom(x);
         }
         return *this;
     }
@@ -157,13 +158,7 @@ public:
      */
     PriorityQueue(const PriorityQueue &x)
     {
-            amount=x.amount;
-            capacity=x.capacity;
-            elements=new V[capacity];
-            point1=new int[capacity];
-            point2=new int[capacity];
-            for(int i=1;i<=amount;++i)elements[i]=x.elements[i];
-            for(int i=1;i<=amount;++i)point1[i]=point2[i]=i;
+        copyFrom(x);
     }
 
 	/**
@@ -174,15 +169,37 @@ public:
 	PriorityQueue(const ArrayList<V> &x)
 	{
 	    amount=x.size();
-        capacity=amount*2;
-        elements=new V[capacity];
-        point1=new int[capacity];
-        point2=new int[capacity];
-        for(int i=0;i<amount;++i)elements[i+1]=x.get(i);
-        for(int i=1;i<=amount;++i)point1[i]=point2[i]=i;
-        for(int i=amount/2;i>0;--i)down(i);
+        capacity=amount>4?amount*2:8;
+        handles=amount;
+        spare=-1;
+        heap=new Slot[capacity];
+        pos=new int[capacity];
+        idOf=new int[capacity];
+        for(int i=0;i<amount;++i)
+        {
+            heap[i].value=x.get(i);
+            heap[i].id=heap[i].handle=pos[i]=idOf[i]=i;
+        }
+        heapify();
 	}
 
+    /**
+     * TODO Constructs a priority queue over the elements in [first,last).
+     * Requires to finish in O(n) time.
+     */
+    template <class I>
+    PriorityQueue(I first, I last)
+    {
+        capacity=8;
+        amount=0;
+        handles=0;
+        spare=-1;
+        heap=new Slot[capacity];
+        pos=new int[capacity];
+        idOf=new int[capacity];
+        pushAll(first,last);
+    }
+
     /**
      * TODO Returns an iterator over the elements in this priority queue.
      */
@@ -197,6 +214,8 @@ public:
     void clear()
     {
         amount=0;
+        handles=0;
+        spare=-1;
     }
 
     /**
@@ -207,7 +226,7 @@ public:
     const V &front() const
     {
         if(empty())throw ElementNotExist();
-        return elements[1];
+        return heap[0].value;
     }
 
     /**
@@ -220,29 +239,121 @@ public:
 
     /**
      * TODO Add an element to the priority queue.
+     * Returns the handle of the element.
+     */
+    Handle push(const V &value)
+    {
+        Handle h=append(value);
+        up(amount-1);
+        return h;
+    }
+
+    /**
+     * TODO Add the elements in [first,last) to the priority queue.
+     * They are appended to the heap and then either sifted up one by one or, when
+     * that would cost more than rebuilding, the whole heap is rebuilt bottom-up in
+     * O(n) time.
+     */
+    template <class I>
+    void pushAll(I first, I last)
+    {
+        int old=amount;
+        for(;first!=last;++first)append(*first);
+        settle(old);
+    }
+
+    /**
+     * TODO Moves all of the elements of x into this priority queue, and leaves x
+     * empty. The handles of this queue stay valid, those of x do not.
+     */
+    void merge(PriorityQueue &&x)
+    {
+        if(&x==this)return;
+        int old=amount;
+        for(int i=0;i<x.amount;++i)append(std::move(x.heap[i].value));
+        x.clear();
+        settle(old);
+    }
+
+    /**
+     * TODO Returns true if the element of the handle is still in this queue.
+     * The handle of a removed element may be returned again by a later push().
      */
-    void push(const V &value)
+    bool contains(Handle h) const
     {
-        if(amount+2>=capacity)enlarge();
-        elements[++amount]=value;
-        point1[amount]=amount;
-        point2[amount]=amount;
-        up(amount);
+        return h>=0 && h<handles && idOf[h]>=0;
+    }
+
+    /**
+     * TODO Returns a const reference to the element of the handle.
+     * @throw ElementNotExist
+     */
+    const V &get(Handle h) const
+    {
+        return heap[at(h)].value;
+    }
+
+    /**
+     * TODO Replaces the element of the handle with value, in O(log n) time.
+     * @throw ElementNotExist
+     */
+    void update(Handle h, const V &value)
+    {
+        int p=at(h);
+        bool less=cmp(value,heap[p].value);
+        heap[p].value=value;
+        if(less)up(p);
+        else down(p);
+    }
+
+    /**
+     * TODO Replaces the element of the handle with value if value is less than it,
+     * as the relaxation of Dijkstra's algorithm does. Returns true if it did.
+     * @throw ElementNotExist
+     */
+    bool decreaseKey(Handle h, const V &value)
+    {
+        int p=at(h);
+        if(!cmp(value,heap[p].value))return 0;
+        heap[p].value=value;
+        up(p);
+        return 1;
+    }
+
+    /**
+     * TODO Removes the element of the handle, in O(log n) time.
+     * @throw ElementNotExist
+     */
+    void erase(Handle h)
+    {
+        at(h);
+        removeId(idOf[h]);
     }
 
     /**
      * TODO Removes the top element of this priority queue if present.
      * If there is no element, throws ElementNotExist exception.
      * @throw ElementNotExist
+     * The last element of the heap takes the place and the id of the top, and the
+     * element with the greatest id takes the id of the last one, so the ids stay
+     * 0..size()-1.
      */
     void pop()
     {
         if(empty())throw ElementNotExist();
-        elements[1]=elements[amount];
-        point1[point2[amount]]=point1[amount];
-        point2[point1[amount]]=point2[amount];
-        --amount;
-        down(1);
+        int top=heap[0].id,last=heap[--amount].id;
+        release(heap[0].handle);
+        if(!amount)return;
+        heap[0]=std::move(heap[amount]);
+        heap[0].id=idOf[heap[0].handle]=top;
+        pos[top]=0;
+        if(last!=amount)
+        {
+            int p=pos[amount];
+            heap[p].id=idOf[heap[p].handle]=last;
+            pos[last]=p;
+        }
+        down(0);
     }
 
     /**
@@ -252,83 +363,196 @@ public:
     {
         return amount;
     }
-/*
-    void show(bool yes=0) const
+private:
+    /**
+     * An element with its id, which names it while it moves in the heap, and its
+     * handle.
+     */
+    struct Slot
     {
-        for(int i=1;i<=amount;i++)std::cout<<elements[i]<<" ";
-        std::cout<<std::endl;
-        if(yes)
+        V value;
+        int id,handle;
+    };
+
+    /**
+     * @param capacity the size of the arrays.
+     * @param amount the number of the elements.
+     * @param heap the heap, the children of heap[i] being heap[i*D+1..i*D+D].
+     * @param pos pos[id] is the position in heap of the element with that id.
+     * @param handles the number of the handles given out.
+     * @param idOf idOf[handle] is the id of the element with that handle, or
+     * -2-next for a free handle, next being the following free handle.
+     * @param spare the first free handle, -1 when there is none.
+     */
+    int capacity,amount,handles,spare;
+    Slot *heap;
+    int *pos,*idOf;
+    C cmp;
+
+    void copyFrom(const PriorityQueue &x)
+    {
+        amount=x.amount;
+        capacity=x.capacity;
+        handles=x.handles;
+        spare=x.spare;
+        heap=new Slot[capacity];
+        pos=new int[capacity];
+        idOf=new int[capacity];
+        for(int i=0;i<amount;++i)
         {
-            for(int i=1;i<=amount;i++)std::cout<<point1[i]<<" ";
-            std::cout<<std::endl;
-            for(int i=1;i<=amount;i++)std::cout<<point2[i]<<" ";
-            std::cout<<std::endl;
+            heap[i].value=x.heap[i].value;
+            heap[i].handle=x.heap[i].handle;
+            heap[i].id=pos[i]=i;
         }
-    }*/
-private:
+        for(int h=0;h<handles;++h)idOf[h]=x.idOf[h]<0?x.idOf[h]:x.pos[x.idOf[h]];
+    }
+
     /**
-     * @param capacity the size of the array.
-     * @param amount the number of the elements of the array.
-     * @param elements the array which restore the elements.
+     * TODO put value at the end of the heap, with a new id and a handle.
      */
-    int capacity,amount;
-    V *elements;
-    int *point1,*point2;
-    C cmp;
+    template <class T>
+    Handle append(T &&value)
+    {
+        if(amount==capacity)enlarge();
+        Handle h=spare;
+        if(h<0)h=handles++;
+        else spare=-2-idOf[h];
+        heap[amount].value=std::forward<T>(value);
+        heap[amount].id=pos[amount]=idOf[h]=amount;
+        heap[amount].handle=h;
+        amount++;
+        return h;
+    }
+
+    /**
+     * TODO restore the heap after the elements from old on were appended. Sifting
+     * them up costs up to one step per level each, rebuilding costs about one
+     * step per element.
+     */
+    void settle(int old)
+    {
+        int depth=0;
+        for(int m=amount;m>1;m/=D)++depth;
+        if((long long)(amount-old)*depth>amount)heapify();
+        else for(int i=old;i<amount;++i)up(i);
+    }
+
+    /**
+     * TODO make the whole array a heap, bottom-up in O(n) time.
+     */
+    void heapify()
+    {
+        for(int i=amount>1?(amount-2)/D:-1;i>=0;--i)down(i);
+    }
+
+    /**
+     * TODO Returns the position of the element of the handle.
+     * @throw ElementNotExist
+     */
+    int at(Handle h) const
+    {
+        if(!contains(h))throw ElementNotExist();
+        return pos[idOf[h]];
+    }
 
     /**
-     * TODO double the capacity of the array.
+     * TODO put the handle on the free list.
+     */
+    void release(Handle h)
+    {
+        idOf[h]=-2-spare;
+        spare=h;
+    }
+
+    /**
+     * TODO double the capacity of the arrays.
      */
     void enlarge()
     {
-        V *temp=new V[capacity*2];
-        int *p1=new int[capacity*2],*p2=new int[capacity*2];
-        for(int i=1;i<=amount;i++)
+        Slot *temp=new Slot[capacity*2];
+        int *p=new int[capacity*2],*q=new int[capacity*2];
+        for(int i=0;i<amount;i++)
         {
-            temp[i]=elements[i];
-            p1[i]=point1[i];
-            p2[i]=point2[i];
+            temp[i]=std::move(heap[i]);
+            p[i]=pos[i];
         }
+        for(int i=0;i<handles;i++)q[i]=idOf[i];
         capacity*=2;
-        delete [] elements;
-        delete [] point1;
-        delete [] point2;
-        elements=temp;
-        point1=p1;
-        point2=p2;
+        delete [] heap;
+        delete [] pos;
+        delete [] idOf;
+        heap=temp;
+        pos=p;
+        idOf=q;
+    }
+
+    /**
+     * TODO remove the element with the id. The element with the greatest id takes
+     * the id, so the ids below it, not returned yet by an iterator, do not change.
+     */
+    void removeId(int id)
+    {
+        int p=pos[id];
+        release(heap[p].handle);
+        --amount;
+        if(p!=amount)
+        {
+            heap[p]=std::move(heap[amount]);
+            pos[heap[p].id]=p;
+        }
+        if(id!=amount)
+        {
+            int q=pos[amount];
+            heap[q].id=idOf[heap[q].handle]=id;
+            pos[id]=q;
+        }
+        if(p<amount)
+        {
+            up(p);
+            down(p);
+        }
     }
 
     /**
-     * TODO shift up the element whose position is index
+     * TODO shift up the element whose position is index. The element is held aside
+     * and the parents greater than it move down into the hole.
      */
     void up(int index)
     {
-        for(int w=index;w!=1;w/=2)
-            if(cmp(elements[w],elements[w/2]))
-               {
-                   std::swap(elements[w],elements[w/2]);
-                   std::swap(point2[point1[w]],point2[point1[w/2]]);
-                   std::swap(point1[w],point1[w/2]);
-               }else break;
+        Slot x=std::move(heap[index]);
+        int w=index;
+        while(w>0)
+        {
+            int parent=(w-1)/D;
+            if(!cmp(x.value,heap[parent].value))break;
+            heap[w]=std::move(heap[parent]);
+            pos[heap[w].id]=w;
+            w=parent;
+        }
+        heap[w]=std::move(x);
+        pos[heap[w].id]=w;
     }
 
     /**
-     * TODO shift down the element whose position is index
+     * TODO shift down the element whose position is index. The least child moves
+     * up into the hole while it is less than the element.
      */
     void down(int index)
     {
-        int j;
-        for(int w=index;w*2<=amount;w=j)
+        Slot x=std::move(heap[index]);
+        int w=index;
+        for(int first=w*D+1;first<amount;first=w*D+1)
         {
-            j=w*2;
-            if(j+1<=amount && cmp(elements[j+1],elements[j]))j++;
-            if(cmp(elements[j],elements[w]))
-            {
-                std::swap(elements[j],elements[w]);
-                std::swap(point2[point1[w]],point2[point1[j]]);
-                std::swap(point1[w],point1[j]);
-            }else break;
+            int j=first,last=std::min(first+D,amount);
+            for(int k=first+1;k<last;++k)
+                if(cmp(heap[k].value,heap[j].value))j=k;
+            if(!cmp(heap[j].value,x.value))break;
+            heap[w]=std::move(heap[j]);
+            pos[heap[w].id]=w;
+            w=j;
         }
+        heap[w]=std::move(x);
+        pos[heap[w].id]=w;
     }
 };
 
@@ -3,15 +3,110 @@
 #define __TREEMAP_H
 
 #include "ElementNotExist.h"
+#include "IndexOutOfBound.h"
+#include "ArrayList.h"
+#include "Allocator.h"
 #include "iostream"
-#include "ctime"
 #include "cstdlib"
+#include <atomic>
+#include <limits>
+#include <type_traits>
+#include <utility>
+
+/**
+ * The default aggregate of TreeMap, which keeps nothing.
+ */
+template <class K, class V>
+struct NoAggregate
+{
+    struct Value{};
+    static Value identity(){return Value();}
+    static Value of(const K &,const V &){return Value();}
+    static Value combine(const Value &,const Value &){return Value();}
+};
+
+/**
+ * The sum of the values.
+ */
+template <class K, class V>
+struct SumAggregate
+{
+    typedef V Value;
+    static Value identity(){return V();}
+    static Value of(const K &,const V &value){return value;}
+    static Value combine(const Value &a,const Value &b){return a+b;}
+};
+
+/**
+ * The least value, std::numeric_limits<V>::max() for no value.
+ */
+template <class K, class V>
+struct MinAggregate
+{
+    typedef V Value;
+    static Value identity(){return std::numeric_limits<V>::max();}
+    static Value of(const K &,const V &value){return value;}
+    static Value combine(const Value &a,const Value &b){return b<a?b:a;}
+};
+
+/**
+ * The greatest value, std::numeric_limits<V>::lowest() for no value.
+ */
+template <class K, class V>
+struct MaxAggregate
+{
+    typedef V Value;
+    static Value identity(){return std::numeric_limits<V>::lowest();}
+    static Value of(const K &,const V &value){return value;}
+    static Value combine(const Value &a,const Value &b){return a<b?b:a;}
+};
 
 /**
  * TreeMap is the balanced-tree implementation of map. The iterators must
  * iterate through the map in the natural order (operator<) of the key.
+ *
+ * Every node knows the size of its subtree, so the order statistics rank(),
+ * select() and countRange() take O(log n) time.
+ *
+ * The navigation methods (floorKey(), ceilingKey(), higherKey(), lowerKey(),
+ * firstKey(), lastKey() and their Entry versions) take O(log n) time, and
+ * subMap(), headMap() and tailMap() return views of a range of keys which
+ * iterate it in O(log n + k) time, without copying anything.
+ *
+ * fromSorted(), the copy constructor and operator= build a treap from entries in
+ * order in O(n) time. split() and join() cut and glue maps in O(log n) time, and
+ * unionWith(), intersectWith() and differenceWith() are built on them.
+ *
+ * The map is persistent: snapshot(), the copy constructor and operator= take
+ * O(1) time and share the nodes, which count their references. put(), remove()
+ * and the other updates copy the O(log n) shared nodes on their path before
+ * changing them, so a snapshot never changes. A snapshot may be read and
+ * destroyed by another thread without any lock while the map is updated; taking
+ * it must be ordered with the updates like any other access to the map.
+ *
+ * The priorities of the treap come from a xorshift generator owned by the map,
+ * so maps used by different threads share no state, and a map built by the same
+ * puts from the same seed always has the same shape.
+ *
+ * Template argument M is a monoid aggregated over every subtree, such as
+ * SumAggregate, MinAggregate or MaxAggregate: a class with a type ``Value''
+ * and the static functions ``identity'' returning the Value of no entry, ``of''
+ * taking a K and a V and returning the Value of one entry, and ``combine''
+ * taking two Values, which must be associative. aggregate(lo, hi) then combines
+ * the entries of a range in key order in O(log n) time:
+ * @code
+ *      TreeMap<long long, long long, SumAggregate<long long, long long> > hits;
+ *      ...
+ *      long long lastMinute = hits.aggregate(now - 60, now + 1);
+ * @endcode
+ *
+ * Template argument A is the node allocator, as in HashMap. With ArenaAllocator
+ * the nodes are carved from a few large blocks instead of one malloc each, and
+ * clear() and the destructor give the blocks back at once. The nodes of an arena
+ * cannot outlive its map, so such maps are not persistent: copies and operator=
+ * copy the nodes in O(n) time, and snapshot() is not available.
  */
-template<class K, class V>
+template<class K, class V, class M=NoAggregate<K,V>, template <class> class A=HeapAllocator>
 class TreeMap
 {
 public:
@@ -20,18 +115,22 @@ public:
         K key;
         V value;
     public:
-        Entry(K k, V v)
-        {
-            key = k;
-            value = v;
-        }
+        Entry(const K &k, const V &v):key(k),value(v){}
+
+        Entry(K &&k, V &&v):key(std::move(k)),value(std::move(v)){}
 
-        K getKey() const
+        /**
+         * TODO Constructs the value in place from args.
+         */
+        template <class KK, class... T>
+        Entry(std::piecewise_construct_t, KK &&k, T&&... args):key(std::forward<KK>(k)),value(std::forward<T>(args)...){}
+
+        const K &getKey() const
         {
             return key;
         }
 
-        V getValue() const
+        const V &getValue() const
         {
             return value;
         }
@@ -39,10 +138,14 @@ public:
         {
             return value;
         }
-        void modifyValue(V _value)
+        void modifyValue(const V &_value)
         {
             value=_value;
         }
+        void modifyValue(V &&_value)
+        {
+            value=std::move(_value);
+        }
     };
 
     class Iterator
@@ -53,8 +156,10 @@ public:
          */
         bool hasNext()
         {
-            if(!cursor)return !base->isEmpty();
-            return base->succ(cursor->elem.getKey());
+            if(path.isEmpty())return 0;
+            if(!bounded)return 1;
+            const K &key=path.get(path.size()-1)->elem.getKey();
+            return reverse?!(key<stop):key<stop;
         }
 
         /**
@@ -64,31 +169,157 @@ public:
         const Entry &next()
         {
             if(!hasNext())throw ElementNotExist();
-            if(!cursor)
+            auto w=path.get(path.size()-1);
+            path.removeIndex(path.size()-1);
+            pushPath(reverse?w->left:w->right);
+            return w->elem;
+        }
+
+        /**
+         * TODO Constructor. Iterates the keys in [lo, hi), a null bound meaning
+         * no bound on that side.
+         */
+        Iterator(const TreeMap<K,V,M,A> *c=0,bool _reverse=0,const K *lo=0,const K *hi=0):reverse(_reverse),bounded(0)
+        {
+            if(!c)return;
+            const K *start=reverse?hi:lo,*end=reverse?lo:hi;
+            if(end)
             {
-                for(cursor=base->root;cursor->left;cursor=cursor->left);
-            }else
+                bounded=1;
+                stop=*end;
+            }
+            for(auto w=c->root;w;)
             {
-                cursor=base->succ(cursor->elem.getKey());
+                if(start && (reverse?!(w->elem.getKey()<*start):w->elem.getKey()<*start))
+                {
+                    w=reverse?w->left:w->right;
+                }else
+                {
+                    path.add(w);
+                    w=reverse?w->right:w->left;
+                }
             }
-            return cursor->elem;
+        }
+    private:
+        /**
+         * @param path the nodes whose entry and right subtree (left subtree when
+         * reverse) are still to be iterated, the next one on the top. Every step
+         * costs O(1) amortized, and a full iteration O(n).
+         * @param reverse iterate in descending order.
+         * @param bounded the iteration stops at stop: before it if not reverse,
+         * or after it if reverse.
+         */
+        ArrayList<struct TreeMap<K,V,M,A>::Node *> path;
+        bool reverse,bounded;
+        K stop;
+
+        void pushPath(struct TreeMap<K,V,M,A>::Node *w)
+        {
+            for(;w;w=reverse?w->right:w->left)path.add(w);
+        }
+    };
+
+    /**
+     * A view of the keys of a map in a range. It is lazy: it copies nothing and
+     * always reflects the current content of the map, so it must not outlive it.
+     */
+    class SubMap
+    {
+    public:
+        /**
+         * TODO Returns an iterator over the elements of the range, in ascending order.
+         */
+        Iterator iterator() const
+        {
+            return Iterator(base,0,hasLo?&lo:0,hasHi?&hi:0);
+        }
+
+        /**
+         * TODO Returns an iterator over the elements of the range, in descending order.
+         */
+        Iterator descendingIterator() const
+        {
+            return Iterator(base,1,hasLo?&lo:0,hasHi?&hi:0);
+        }
+
+        /**
+         * TODO Returns true if the range contains a mapping for the specified key.
+         */
+        bool containsKey(const K &key) const
+        {
+            return inRange(key) && base->containsKey(key);
+        }
+
+        /**
+         * TODO Returns a const reference to the value to which the specified key is mapped.
+         * If the key is not present in the range, throws ElementNotExist exception.
+         * @throw ElementNotExist
+         */
+        const V &get(const K &key) const
+        {
+            if(!inRange(key))throw ElementNotExist();
+            return base->get(key);
+        }
+
+        /**
+         * TODO Returns true if the range contains no mappings.
+         */
+        bool isEmpty() const
+        {
+            return size()==0;
+        }
+
+        /**
+         * TODO Returns the number of mappings in the range, in O(log n) time.
+         */
+        int size() const
+        {
+            int l=hasLo?base->rank(lo):0,r=hasHi?base->rank(hi):base->size();
+            return r>l?r-l:0;
+        }
+
+        /**
+         * TODO Returns the aggregate of the mappings in the range, in O(log n) time.
+         */
+        typename M::Value aggregate() const
+        {
+            return base->aggregateRange(hasLo?&lo:0,hasHi?&hi:0);
         }
 
         /**
          * TODO Constructor
          */
-        Iterator(const TreeMap<K,V> *c=0):base(c),cursor(0)
+        SubMap(const TreeMap<K,V,M,A> *c,const K *_lo,const K *_hi):base(c),hasLo(_lo!=0),hasHi(_hi!=0)
         {
+            if(_lo)lo=*_lo;
+            if(_hi)hi=*_hi;
         }
     private:
-        const TreeMap<K,V> *base;
-        struct TreeMap<K,V>::Node *cursor;
+        /**
+         * @param lo the smallest key of the range, if hasLo.
+         * @param hi the key after the range, if hasHi.
+         */
+        const TreeMap<K,V,M,A> *base;
+        K lo,hi;
+        bool hasLo,hasHi;
+
+        bool inRange(const K &key) const
+        {
+            return !(hasLo && key<lo) && !(hasHi && !(key<hi));
+        }
     };
 
     /**
      * TODO Constructs an empty tree map.
      */
-    TreeMap():amount(0),root(NULL)
+    TreeMap():amount(0),root(NULL),random(defaultSeed)
+    {
+    }
+
+    /**
+     * TODO Constructs an empty tree map whose priorities are generated from seed.
+     */
+    explicit TreeMap(unsigned int seed):amount(0),root(NULL),random(seed?seed:defaultSeed)
     {
     }
 
@@ -108,29 +339,52 @@ public:
         if(&x!=this)
         {
             clear();
-            auto it=x.iterator();
-            while(it.hasNext())
-            {
-                auto temp=it.next();
-                put(temp.getKey(),temp.getValue());
-            }
+            root=nodesOf(x);
+            amount=x.amount;
         }
         return *this;
     }
 
     /**
-     * TODO Copy-constructor
+     * TODO Copy-constructor. The nodes are shared with x in O(1) time and copied
+     * when either map changes them (copied in O(n) time with a bulk allocator).
      */
-    TreeMap(const TreeMap &x)
+    TreeMap(const TreeMap &x):amount(x.amount),root(NULL),random(defaultSeed)
     {
-        amount=0;
-        root=0;
-        auto it=x.iterator();
-        while(it.hasNext())
+        root=nodesOf(x);
+    }
+
+    /**
+     * TODO Returns a frozen copy of this map in O(1) time. It can be iterated and
+     * queried while this map goes on changing, without any lock. The references
+     * returned by getOrInsert() before must not be written through any more.
+     */
+    TreeMap snapshot() const
+    {
+        static_assert(!A<Node>::bulk,"snapshot() needs an allocator whose nodes can outlive the map");
+        return *this;
+    }
+
+    /**
+     * TODO Returns a map of the (first, second) pairs of the range [first, last),
+     * whose keys are strictly increasing, built in O(n) time instead of the
+     * O(n log n) of n puts. If a key is not greater than the previous one, it
+     * and the rest of the range are put one by one.
+     */
+    template <class It>
+    static TreeMap fromSorted(It first, It last)
+    {
+        TreeMap res;
+        ArrayList<Node *> spine;
+        for(;first!=last;++first)
         {
-            auto temp=it.next();
-            put(temp.getKey(),temp.getValue());
+            if(!spine.isEmpty() && !(spine.get(spine.size()-1)->elem.getKey()<first->first))break;
+            res.pushSorted(spine,first->first,first->second);
         }
+        res.root=finishSorted(spine);
+        res.amount=sizeOf(res.root);
+        for(;first!=last;++first)res.put(first->first,first->second);
+        return res;
     }
 
     /**
@@ -141,12 +395,21 @@ public:
         return Iterator(this);
     }
 
+    /**
+     * TODO Returns an iterator over the elements in this map in descending order.
+     */
+    Iterator descendingIterator() const
+    {
+        return Iterator(this,1);
+    }
+
     /**
      * TODO Removes all of the mappings from this map.
      */
     void clear()
     {
-        removeall(root);
+        if(!(A<Node>::bulk && std::is_trivially_destructible<Node>::value))removeall(root);
+        alloc.release();
         amount=0;
         root=0;
     }
@@ -173,7 +436,12 @@ public:
      */
     bool containsValue(const V &value) const
     {
-        return containsValue(root,value);
+        auto it=iterator();
+        while(it.hasNext())
+        {
+            if(it.next().getValue()==value)return 1;
+        }
+        return 0;
     }
 
     /**
@@ -208,7 +476,57 @@ public:
      */
     void put(const K &key, const V &value)
     {
-            put(root,key,value);
+        bool inserted;
+        Node *a=findOrInsert(key,inserted,key,value);
+        if(!inserted)
+        {
+            a->elem.modifyValue(value);
+            updatePath(a);
+        }
+    }
+
+    /**
+     * TODO Same as put(const K &, const V &), but the key and the value are moved
+     * into the map instead of being copied.
+     */
+    void put(K &&key, V &&value)
+    {
+        bool inserted;
+        Node *a=findOrInsert(key,inserted,std::move(key),std::move(value));
+        if(!inserted)
+        {
+            a->elem.modifyValue(std::move(value));
+            updatePath(a);
+        }
+    }
+
+    /**
+     * TODO If the key is not present, inserts it with a value constructed in place
+     * from args, and returns true. Otherwise returns false and changes nothing.
+     */
+    template <class... T>
+    bool emplace(const K &key, T&&... args)
+    {
+        bool inserted;
+        findOrInsert(key,inserted,std::piecewise_construct,key,std::forward<T>(args)...);
+        return inserted;
+    }
+
+    /**
+     * TODO Returns a reference to the value to which the specified key is mapped.
+     * If the key is not present, a default-constructed value is inserted first.
+     * The reference is into a node that copies and snapshots of the map share:
+     * snapshot(), the copy constructor and operator= invalidate it, as writing
+     * through it would then change the copies too. Call getOrInsert() again after
+     * them, which copies the node first. The reference is also invalidated when
+     * the key is removed. Not available with an aggregate, which would miss the
+     * changes.
+     */
+    V &getOrInsert(const K &key)
+    {
+        static_assert(std::is_same<M,NoAggregate<K,V> >::value,"getOrInsert() would bypass the aggregate, use put()");
+        bool inserted;
+        return findOrInsert(key,inserted,std::piecewise_construct,key)->elem.getConstValue();
     }
 
 
@@ -219,10 +537,42 @@ public:
      */
     void remove(const K &key)
     {
-        if(!containsKey(key))throw ElementNotExist();
+        links.clear();
+        Node **v=&root;
+        while(*v)
+        {
+            *v=own(*v);
+            if(key<(*v)->elem.getKey())
+            {
+                links.add(v);
+                v=&(*v)->left;
+            }else if((*v)->elem.getKey()<key)
+            {
+                links.add(v);
+                v=&(*v)->right;
+            }else break;
+        }
+        if(!*v)throw ElementNotExist();
+        while((*v)->left && (*v)->right)
+        {
+            links.add(v);
+            if((*v)->left->seed<(*v)->right->seed)
+            {
+                (*v)->left=own((*v)->left);
+                rightRotate(*v);
+                v=&(*v)->right;
+            }else
+            {
+                (*v)->right=own((*v)->right);
+                leftRotate(*v);
+                v=&(*v)->left;
+            }
+        }
+        Node *a=*v;
+        *v=a->left?a->left:a->right;
+        destroyNode(a);
         amount--;
-        //show(root);
-        remove(root,key);
+        for(int i=links.size()-1;i>=0;--i)update(*links.get(i));
     }
 
     /**
@@ -233,24 +583,428 @@ public:
         return amount;
     }
 
+    /**
+     * TODO Restarts the generator of the priorities from seed. The nodes already
+     * in the map keep their priorities.
+     */
+    void setSeed(unsigned int seed)
+    {
+        random=seed?seed:defaultSeed;
+    }
+
+    /**
+     * TODO Returns the number of keys strictly less than the specified key.
+     * The key does not need to be present in this map.
+     */
+    int rank(const K &key) const
+    {
+        int res=0;
+        for(Node *w=root;w;)
+        {
+            if(w->elem.getKey()<key)
+            {
+                res+=sizeOf(w->left)+1;
+                w=w->right;
+            }else w=w->left;
+        }
+        return res;
+    }
+
+    /**
+     * TODO Returns the entry with the k-th smallest key, k being zero-based,
+     * with range [0, size).
+     * @throw IndexOutOfBound
+     */
+    const Entry &select(int k) const
+    {
+        if(k<0 || k>=amount)throw IndexOutOfBound();
+        Node *w=root;
+        while(1)
+        {
+            int l=sizeOf(w->left);
+            if(k==l)return w->elem;
+            if(k<l)w=w->left;
+            else
+            {
+                k-=l+1;
+                w=w->right;
+            }
+        }
+    }
+
+    /**
+     * TODO Returns the number of keys in the range [lo, hi).
+     */
+    int countRange(const K &lo, const K &hi) const
+    {
+        if(!(lo<hi))return 0;
+        return rank(hi)-rank(lo);
+    }
+
+    /**
+     * TODO Returns M::combine of the values M::of(key, value) of the mappings whose
+     * keys are in the range [lo, hi), in key order, in O(log n) time.
+     * Returns M::identity() if there is no such mapping.
+     */
+    typename M::Value aggregate(const K &lo, const K &hi) const
+    {
+        return aggregateRange(&lo,&hi);
+    }
+
+    /**
+     * TODO Returns the aggregate of all the mappings, in O(1) time.
+     */
+    typename M::Value aggregate() const
+    {
+        return aggregateOf(root);
+    }
+
+    /**
+     * TODO Returns the entry with the greatest key less than or equal to the given key.
+     * If there is no such key, throws ElementNotExist exception.
+     * @throw ElementNotExist
+     */
+    const Entry &floorEntry(const K &key) const
+    {
+        return entryOf(lowerNode(key,1));
+    }
+
+    /**
+     * TODO Returns the entry with the least key greater than or equal to the given key.
+     * @throw ElementNotExist
+     */
+    const Entry &ceilingEntry(const K &key) const
+    {
+        return entryOf(higherNode(key,1));
+    }
+
+    /**
+     * TODO Returns the entry with the least key strictly greater than the given key.
+     * @throw ElementNotExist
+     */
+    const Entry &higherEntry(const K &key) const
+    {
+        return entryOf(higherNode(key,0));
+    }
+
+    /**
+     * TODO Returns the entry with the greatest key strictly less than the given key.
+     * @throw ElementNotExist
+     */
+    const Entry &lowerEntry(const K &key) const
+    {
+        return entryOf(lowerNode(key,0));
+    }
+
+    /**
+     * TODO Returns the entry with the least key in this map.
+     * @throw ElementNotExist
+     */
+    const Entry &firstEntry() const
+    {
+        Node *w=root;
+        if(w)for(;w->left;w=w->left);
+        return entryOf(w);
+    }
+
+    /**
+     * TODO Returns the entry with the greatest key in this map.
+     * @throw ElementNotExist
+     */
+    const Entry &lastEntry() const
+    {
+        Node *w=root;
+        if(w)for(;w->right;w=w->right);
+        return entryOf(w);
+    }
+
+    /**
+     * TODO Same as floorEntry(key).getKey().
+     * @throw ElementNotExist
+     */
+    const K &floorKey(const K &key) const
+    {
+        return floorEntry(key).getKey();
+    }
+
+    /**
+     * TODO Same as ceilingEntry(key).getKey().
+     * @throw ElementNotExist
+     */
+    const K &ceilingKey(const K &key) const
+    {
+        return ceilingEntry(key).getKey();
+    }
+
+    /**
+     * TODO Same as higherEntry(key).getKey().
+     * @throw ElementNotExist
+     */
+    const K &higherKey(const K &key) const
+    {
+        return higherEntry(key).getKey();
+    }
+
+    /**
+     * TODO Same as lowerEntry(key).getKey().
+     * @throw ElementNotExist
+     */
+    const K &lowerKey(const K &key) const
+    {
+        return lowerEntry(key).getKey();
+    }
+
+    /**
+     * TODO Same as firstEntry().getKey().
+     * @throw ElementNotExist
+     */
+    const K &firstKey() const
+    {
+        return firstEntry().getKey();
+    }
+
+    /**
+     * TODO Same as lastEntry().getKey().
+     * @throw ElementNotExist
+     */
+    const K &lastKey() const
+    {
+        return lastEntry().getKey();
+    }
+
+    /**
+     * TODO Removes and returns the entry with the least key in this map.
+     * If this map is empty, throws ElementNotExist exception.
+     * @throw ElementNotExist
+     */
+    Entry pollFirst()
+    {
+        Entry res=firstEntry();
+        remove(res.getKey());
+        return res;
+    }
+
+    /**
+     * TODO Removes and returns the entry with the greatest key in this map.
+     * @throw ElementNotExist
+     */
+    Entry pollLast()
+    {
+        Entry res=lastEntry();
+        remove(res.getKey());
+        return res;
+    }
+
+    /**
+     * TODO Returns a view of the mappings whose keys are in [lo, hi).
+     */
+    SubMap subMap(const K &lo, const K &hi) const
+    {
+        return SubMap(this,&lo,&hi);
+    }
+
+    /**
+     * TODO Returns a view of the mappings whose keys are less than hi.
+     */
+    SubMap headMap(const K &hi) const
+    {
+        return SubMap(this,0,&hi);
+    }
+
+    /**
+     * TODO Returns a view of the mappings whose keys are greater than or equal to lo.
+     */
+    SubMap tailMap(const K &lo) const
+    {
+        return SubMap(this,&lo,0);
+    }
+
+    /**
+     * TODO Moves the mappings whose keys are greater than or equal to key into right,
+     * whose previous mappings are removed. Takes O(log n) time. With a bulk
+     * allocator the nodes cannot move between maps, so the moved mappings are
+     * copied into right, in O(log n + m) time for m of them.
+     */
+    void split(const K &key, TreeMap &right)
+    {
+        if(&right==this)return;
+        right.clear();
+        Node *r;
+        if(A<Node>::bulk)
+        {
+            ArrayList<Node *> spine;
+            auto it=tailMap(key).iterator();
+            while(it.hasNext())
+            {
+                const Entry &temp=it.next();
+                right.pushSorted(spine,temp.getKey(),temp.getValue());
+            }
+            right.root=finishSorted(spine);
+            splitNode(root,key,root,r,0);
+            removeall(r);
+        }
+        else splitNode(root,key,root,right.root,0);
+        amount=sizeOf(root);
+        right.amount=sizeOf(right.root);
+    }
+
+    /**
+     * TODO Moves the mappings of right, whose keys must all be greater than the keys
+     * of this map, to the end of this map in O(log n) time. right becomes empty.
+     * If the keys overlap, the maps are merged as by unionWith() instead.
+     * With a bulk allocator the mappings of right are copied, in O(m) time.
+     */
+    void join(TreeMap &right)
+    {
+        if(&right==this || !right.root)return;
+        Node *b=right.root;
+        if(A<Node>::bulk)
+        {
+            b=nodesOf(right);
+            right.clear();
+        }
+        right.root=0;
+        right.amount=0;
+        Node *a=root,*first=b;
+        while(a && a->right)a=a->right;
+        while(first->left)first=first->left;
+        if(a && !(a->elem.getKey()<first->elem.getKey()))root=unite(root,b);
+        else root=joinNodes(root,b);
+        amount=sizeOf(root);
+    }
+
+    /**
+     * TODO Adds the mappings of x to this map. For a key in both maps, the value of x
+     * is kept, as put() would do. Takes O(m log(n/m + 1)) time, where m <= n are
+     * the sizes of the two maps; the nodes of x are shared, not copied, unless A
+     * is a bulk allocator.
+     */
+    void unionWith(const TreeMap &x)
+    {
+        root=unite(root,nodesOf(x));
+        amount=sizeOf(root);
+    }
+
+    /**
+     * TODO Removes the mappings whose keys are not in x. The values are not changed.
+     */
+    void intersectWith(const TreeMap &x)
+    {
+        root=intersect(root,nodesOf(x));
+        amount=sizeOf(root);
+    }
+
+    /**
+     * TODO Removes the mappings whose keys are in x.
+     */
+    void differenceWith(const TreeMap &x)
+    {
+        root=subtract(root,nodesOf(x));
+        amount=sizeOf(root);
+    }
+
 private:
     struct Node
     {
         Entry elem;
         Node *left,*right;
         unsigned int seed;
-        Node(Entry _elem,Node *_left,Node *_right):elem(_elem),left(_left),right(_right)
+        int size;
+        std::atomic<int> refs;
+        typename M::Value agg;
+        template <class... T>
+        Node(Node *_left,Node *_right,unsigned int _seed,T&&... args):elem(std::forward<T>(args)...),left(_left),right(_right),seed(_seed),size(1),refs(1),agg(M::of(elem.getKey(),elem.getValue()))
         {
-            seed=(rand()<<31)+rand();
         }
     };
 
     /**
      * @param amount the size of the tree
      * @param root the root of the splay
+     * @param links the links followed by the last put() or remove(), from the root
+     * down, kept as a member so that its buffer is reused by the next call.
+     * @param random the state of the generator of the priorities, never 0.
+     * @param alloc the allocator of the nodes.
      */
     int amount;
     Node *root;
+    ArrayList<Node **> links;
+    unsigned int random;
+    A<Node> alloc;
+
+    static const unsigned int defaultSeed=2463534242u;
+
+    /**
+     * TODO the next priority, by xorshift32
+     */
+    unsigned int nextPriority()
+    {
+        random^=random<<13;
+        random^=random>>17;
+        random^=random<<5;
+        return random;
+    }
+
+    static int sizeOf(Node *v)
+    {
+        return v?v->size:0;
+    }
+
+    static typename M::Value aggregateOf(Node *v)
+    {
+        return v?v->agg:M::identity();
+    }
+
+    static typename M::Value aggregateOfNode(Node *v)
+    {
+        return M::of(v->elem.getKey(),v->elem.getValue());
+    }
+
+    /**
+     * TODO recalculate the size and the aggregate of v from its children
+     */
+    static void update(Node *v)
+    {
+        v->size=sizeOf(v->left)+sizeOf(v->right)+1;
+        v->agg=M::combine(M::combine(aggregateOf(v->left),aggregateOfNode(v)),aggregateOf(v->right));
+    }
+
+    /**
+     * TODO the aggregate of the keys in [*lo, *hi), a missing bound being unbounded.
+     * w is the highest node in the range; the part of its left subtree from lo and
+     * the part of its right subtree before hi are collected along one path each.
+     */
+    typename M::Value aggregateRange(const K *lo,const K *hi) const
+    {
+        Node *w=root;
+        while(w)
+        {
+            if(lo && w->elem.getKey()<*lo)w=w->right;
+            else if(hi && !(w->elem.getKey()<*hi))w=w->left;
+            else break;
+        }
+        if(!w)return M::identity();
+        typename M::Value l=lo?M::identity():aggregateOf(w->left),r=hi?M::identity():aggregateOf(w->right);
+        for(Node *v=lo?w->left:0;v;)
+        {
+            if(v->elem.getKey()<*lo)v=v->right;
+            else
+            {
+                l=M::combine(aggregateOfNode(v),M::combine(aggregateOf(v->right),l));
+                v=v->left;
+            }
+        }
+        for(Node *v=hi?w->right:0;v;)
+        {
+            if(!(v->elem.getKey()<*hi))v=v->left;
+            else
+            {
+                r=M::combine(M::combine(r,aggregateOf(v->left)),aggregateOfNode(v));
+                v=v->right;
+            }
+        }
+        return M::combine(M::combine(l,aggregateOfNode(w)),r);
+    }
 
     /**
      * TODO right rotate
@@ -260,6 +1014,8 @@ private:
         auto y=x->left;
         x->left=y->right;
         y->right=x;
+        update(x);
+        update(y);
         x=y;
     }
 
@@ -271,95 +1027,355 @@ private:
         auto y=x->right;
         x->right=y->left;
         y->left=x;
+        update(x);
+        update(y);
         x=y;
     }
 
-    void put(Node *&v,const K &key,const V &value)
+    /**
+     * TODO drop a reference to the subtree of v, and delete the nodes which are
+     * no longer referenced, without recursion: while v has a left child, it is
+     * rotated to the right, so that the tree becomes a chain of right children.
+     * A child still referenced by another tree is only unlinked. The nodes of the
+     * chain are ours, with a count of 0, so they are not counted again.
+     */
+    void removeall(Node *v)
     {
-        if(v)
+        if(v && --v->refs>0)return;
+        while(v)
         {
-            if(!(v->elem.getKey()<key || key<v->elem.getKey()))
+            Node *l=v->left;
+            if(l && --l->refs>0)v->left=l=0;
+            if(l)
             {
-                v->elem.modifyValue(value);
+                v->left=l->right;
+                l->right=v;
+                v=l;
             }else
             {
-                if(key<v->elem.getKey())
-                {
-                    put(v->left,key,value);
-                    if(v->left->seed<v->seed)rightRotate(v);
-                }else
-                {
-                    put(v->right,key,value);
-                    if(v->right->seed<v->seed)leftRotate(v);
-                }
+                Node *r=v->right;
+                destroyNode(v);
+                v=(r && r->refs!=0 && --r->refs>0)?0:r;
             }
-        }else
+        }
+    }
+
+    template <class... T>
+    Node *newNode(Node *left,Node *right,unsigned int seed,T&&... args)
+    {
+        return new (alloc.allocate()) Node(left,right,seed,std::forward<T>(args)...);
+    }
+
+    void destroyNode(Node *a)
+    {
+        if(!a)return;
+        a->~Node();
+        alloc.deallocate(a);
+    }
+
+    /**
+     * TODO Returns the nodes of x for this map: x.root with one more reference, or
+     * a copy of the tree of x in O(n) time with a bulk allocator.
+     */
+    Node *nodesOf(const TreeMap &x)
+    {
+        if(!A<Node>::bulk)return share(x.root);
+        ArrayList<Node *> spine;
+        auto it=x.iterator();
+        while(it.hasNext())
         {
-            v=new Node(Entry(key,value),0,0);
-            amount++;
+            const Entry &temp=it.next();
+            pushSorted(spine,temp.getKey(),temp.getValue());
         }
+        return finishSorted(spine);
+    }
+
+    /**
+     * TODO add a reference to the subtree of v
+     */
+    static Node *share(Node *v)
+    {
+        if(v)v->refs++;
+        return v;
+    }
+
+    /**
+     * TODO Returns v if this tree is its only owner, otherwise a copy of v, which
+     * shares the children of v, and drops the reference to v. The result may be
+     * changed freely.
+     */
+    Node *own(Node *v)
+    {
+        if(!v || v->refs==1)return v;
+        Node *a=newNode(share(v->left),share(v->right),v->seed,v->elem);
+        a->size=v->size;
+        a->agg=v->agg;
+        removeall(v);
+        return a;
     }
 
-    void remove(Node *&v,const K &key)
+
+    /**
+     * TODO Returns the node of key, owned by this map. If there is none, a node whose
+     * Entry is constructed from args is inserted, and inserted is set. The links
+     * to the ancestors of the node are left in links.
+     */
+    template <class... T>
+    Node *findOrInsert(const K &key,bool &inserted,T&&... args)
     {
-        if(!(v->elem.getKey()<key || key<v->elem.getKey()))
+        links.clear();
+        Node **v=&root;
+        inserted=0;
+        while(*v)
         {
-            if(!(v->left) && !(v->right))
+            *v=own(*v);
+            if(key<(*v)->elem.getKey())
             {
-                delete v;
-                v=0;
-                return;
-            }
-            if(v->right==0)
+                links.add(v);
+                v=&(*v)->left;
+            }else if((*v)->elem.getKey()<key)
             {
-                rightRotate(v);
-                remove(v->right,key);
-                return;
-            }
-            if(v->left==0)
+                links.add(v);
+                v=&(*v)->right;
+            }else return *v;
+        }
+        Node *a=*v=newNode(0,0,nextPriority(),std::forward<T>(args)...);
+        amount++;
+        inserted=1;
+        for(int i=links.size()-1;i>=0;--i)
+        {
+            Node *&w=*links.get(i);
+            if(w->left && w->left->seed<w->seed)rightRotate(w);
+            else if(w->right && w->right->seed<w->seed)leftRotate(w);
+            else update(w);
+        }
+        return a;
+    }
+
+    /**
+     * TODO recalculate a and its ancestors in links after the value of a changed
+     */
+    void updatePath(Node *a)
+    {
+        update(a);
+        for(int i=links.size()-1;i>=0;--i)update(*links.get(i));
+    }
+
+    /**
+     * TODO add a node for (key, value), whose key is greater than all the keys added
+     * so far, to the treap whose right spine is kept in spine. The nodes popped
+     * from the spine are complete, so their sizes are final.
+     */
+    void pushSorted(ArrayList<Node *> &spine,const K &key,const V &value)
+    {
+        Node *a=newNode(0,0,nextPriority(),key,value);
+        while(!spine.isEmpty() && a->seed<spine.get(spine.size()-1)->seed)
+        {
+            a->left=spine.get(spine.size()-1);
+            spine.removeIndex(spine.size()-1);
+            update(a->left);
+        }
+        if(!spine.isEmpty())spine.get(spine.size()-1)->right=a;
+        spine.add(a);
+    }
+
+    /**
+     * TODO complete the sizes along the spine left by pushSorted() and return the root
+     */
+    static Node *finishSorted(ArrayList<Node *> &spine)
+    {
+        for(int i=spine.size()-1;i>=0;--i)update(spine.get(i));
+        return spine.isEmpty()?0:spine.get(0);
+    }
+
+
+    /**
+     * TODO split the treap t into l, with the keys less than key, and r, with the
+     * others. If detach, the node with key is not put in r but returned alone.
+     * The sizes along the two paths are recalculated from the bottom up.
+     */
+    Node *splitNode(Node *t,const K &key,Node *&l,Node *&r,bool detach)
+    {
+        Node **a=&l,**b=&r,*mid=0;
+        links.clear();
+        while(t)
+        {
+            t=own(t);
+            if(t->elem.getKey()<key)
+            {
+                *a=t;
+                links.add(a);
+                a=&t->right;
+                t=t->right;
+            }else if(!detach || key<t->elem.getKey())
+            {
+                *b=t;
+                links.add(b);
+                b=&t->left;
+                t=t->left;
+            }else
             {
-                leftRotate(v);
-                remove(v->left,key);
-                return;
+                mid=t;
+                break;
             }
-            if(v->left->seed<v->right->seed)
+        }
+        *a=mid?mid->left:0;
+        *b=mid?mid->right:0;
+        for(int i=links.size()-1;i>=0;--i)update(*links.get(i));
+        if(mid)
+        {
+            mid->left=mid->right=0;
+            update(mid);
+        }
+        return mid;
+    }
+
+    /**
+     * TODO join the treaps a and b, where the keys of a are less than those of b
+     */
+    Node *joinNodes(Node *a,Node *b)
+    {
+        Node *res,**v=&res;
+        links.clear();
+        while(a && b)
+        {
+            links.add(v);
+            if(a->seed<b->seed)
             {
-                rightRotate(v);
-                remove(v->right,key);
+                *v=a=own(a);
+                v=&a->right;
+                a=a->right;
             }else
             {
-                leftRotate(v);
-                remove(v->left,key);
+                *v=b=own(b);
+                v=&b->left;
+                b=b->left;
             }
-        }else
+        }
+        *v=a?a:b;
+        for(int i=links.size()-1;i>=0;--i)update(*links.get(i));
+        return res;
+    }
+
+    /**
+     * TODO the union of the treaps a and b, which are consumed. The root with the
+     * smaller seed stays the root and the other treap is split by its key, so the
+     * heap order holds. For a key in both, the value in b is kept.
+     */
+    Node *unite(Node *a,Node *b)
+    {
+        if(!a)return b;
+        if(!b)return a;
+        Node *l,*r,*mid;
+        if(a->seed<=b->seed)
         {
-            if(key<v->elem.getKey())remove(v->left,key);else remove(v->right,key);
+            a=own(a);
+            mid=splitNode(b,a->elem.getKey(),l,r,1);
+            if(mid)a->elem=std::move(mid->elem);
+            destroyNode(mid);
+            a->left=unite(a->left,l);
+            a->right=unite(a->right,r);
+            update(a);
+            return a;
         }
+        b=own(b);
+        mid=splitNode(a,b->elem.getKey(),l,r,1);
+        destroyNode(mid);
+        b->left=unite(l,b->left);
+        b->right=unite(r,b->right);
+        update(b);
+        return b;
     }
 
-    void removeall(Node *v)
+    /**
+     * TODO the treap of the nodes of a whose keys are in b. Both are consumed.
+     */
+    Node *intersect(Node *a,Node *b)
     {
-        if(!v)return;
-        removeall(v->left);
-        removeall(v->right);
-        delete v;
+        if(!a || !b)
+        {
+            removeall(a);
+            removeall(b);
+            return 0;
+        }
+        Node *l,*r,*mid;
+        if(a->seed<=b->seed)
+        {
+            a=own(a);
+            mid=splitNode(b,a->elem.getKey(),l,r,1);
+            Node *x=intersect(a->left,l),*y=intersect(a->right,r);
+            if(!mid)
+            {
+                destroyNode(a);
+                return joinNodes(x,y);
+            }
+            destroyNode(mid);
+            a->left=x;
+            a->right=y;
+            update(a);
+            return a;
+        }
+        b=own(b);
+        mid=splitNode(a,b->elem.getKey(),l,r,1);
+        Node *x=intersect(l,b->left),*y=intersect(r,b->right);
+        if(!mid)
+        {
+            destroyNode(b);
+            return joinNodes(x,y);
+        }
+        b->elem=std::move(mid->elem);
+        destroyNode(mid);
+        b->left=x;
+        b->right=y;
+        update(b);
+        return b;
     }
+
     /**
-     * TODO Returns true if this map maps one or more keys to the specified value. (private)
+     * TODO the treap of the nodes of a whose keys are not in b. Both are consumed.
      */
-    bool containsValue(Node* const &v,const V &value)const
+    Node *subtract(Node *a,Node *b)
     {
-        if(v==NULL)return 0;
-        if(v->elem.getValue()==value)return 1;
-        return containsValue(v->left,value) || containsValue(v->right,value);
+        if(!a || !b)
+        {
+            removeall(b);
+            return a;
+        }
+        Node *l,*r,*mid;
+        if(a->seed<=b->seed)
+        {
+            a=own(a);
+            mid=splitNode(b,a->elem.getKey(),l,r,1);
+            Node *x=subtract(a->left,l),*y=subtract(a->right,r);
+            if(mid)
+            {
+                destroyNode(mid);
+                destroyNode(a);
+                return joinNodes(x,y);
+            }
+            a->left=x;
+            a->right=y;
+            update(a);
+            return a;
+        }
+        b=own(b);
+        mid=splitNode(a,b->elem.getKey(),l,r,1);
+        Node *x=subtract(l,b->left),*y=subtract(r,b->right);
+        destroyNode(mid);
+        destroyNode(b);
+        return joinNodes(x,y);
     }
 
-    Node *succ(const K &key)const
+    /**
+     * TODO Returns the node with the least key greater than key (or equal to key
+     * if inclusive), or 0 if there is none.
+     */
+    Node *higherNode(const K &key,bool inclusive)const
     {
         Node *w=root,*res=0;
         while(w)
         {
-            if(key<w->elem.getKey())
+            if(key<w->elem.getKey() || (inclusive && !(w->elem.getKey()<key)))
             {
                 res=w;
                 w=w->left;
@@ -367,6 +1383,30 @@ private:
         }
         return res;
     }
+
+    /**
+     * TODO Returns the node with the greatest key less than key (or equal to key
+     * if inclusive), or 0 if there is none.
+     */
+    Node *lowerNode(const K &key,bool inclusive)const
+    {
+        Node *w=root,*res=0;
+        while(w)
+        {
+            if(w->elem.getKey()<key || (inclusive && !(key<w->elem.getKey())))
+            {
+                res=w;
+                w=w->right;
+            }else w=w->left;
+        }
+        return res;
+    }
+
+    const Entry &entryOf(Node *v)const
+    {
+        if(!v)throw ElementNotExist();
+        return v->elem;
+    }
 };
 
 #endif
@@ -0,0 +1,565 @@
+/**
+ * Benchmarks of the containers.
+ * Build with ``make bench'' and run ./bench, the numbers are operations per second.
+ */
+#include "HashMap.h"
+#include "ConcurrentHashMap.h"
+#include "TreeMap.h"
+#include "BTreeMap.h"
+#include "ConcurrentTreeMap.h"
+#include "PriorityQueue.h"
+#include "PairingHeap.h"
+#include "MonotonePriorityQueue.h"
+#include "iostream"
+#include "cstdio"
+#include <thread>
+#include <mutex>
+#include <chrono>
+#include <vector>
+#include <utility>
+#include <atomic>
+#include <pthread.h>
+using namespace std;
+
+class Hashint
+{
+public:
+    static int hashCode(int obj)
+    {
+        return obj;
+    }
+};
+
+static unsigned int Rand(unsigned int &seed)
+{
+    seed^=seed<<13;
+    seed^=seed>>17;
+    seed^=seed<<5;
+    return seed;
+}
+
+template <class F>
+double timeIt(F fn)
+{
+    auto start=chrono::steady_clock::now();
+    fn();
+    return chrono::duration<double>(chrono::steady_clock::now()-start).count();
+}
+
+//----------------------bench ConcurrentHashMap--------------------------
+
+const int keyRange=1<<16;
+const int opsPerThread=200000;
+
+/**
+ * A HashMap behind one global mutex, which is what ConcurrentHashMap replaces.
+ */
+class LockedHashMap
+{
+public:
+    bool containsKey(int key)
+    {
+        lock_guard<mutex> guard(lock);
+        return map.containsKey(key);
+    }
+    void put(int key,int value)
+    {
+        lock_guard<mutex> guard(lock);
+        map.put(key,value);
+    }
+private:
+    mutex lock;
+    HashMap<int,int,Hashint> map;
+};
+
+template <class M>
+double runMix(M &map,int threads,int writePercent)
+{
+    vector<thread> workers;
+    double t=timeIt([&]()
+    {
+        for(int i=0;i<threads;++i)
+            workers.push_back(thread([&map,i,writePercent]()
+            {
+                unsigned int seed=i*7919+1;
+                for(int j=0;j<opsPerThread;++j)
+                {
+                    int key=Rand(seed)%keyRange;
+                    if((int)(Rand(seed)%100)<writePercent)map.put(key,j);
+                    else map.containsKey(key);
+                }
+            }));
+        for(auto &w:workers)w.join();
+    });
+    return threads*(double)opsPerThread/t;
+}
+
+void benchConcurrentHash()
+{
+    cout<<"Bench ConcurrentHashMap"<<endl;
+    int mixes[2]={10,90};
+    for(int m=0;m<2;++m)
+    {
+        printf("%d%% writes\n%8s %16s %16s\n",mixes[m],"threads","global mutex","sharded");
+        for(int threads=1;threads<=64;threads*=2)
+        {
+            LockedHashMap a;
+            ConcurrentHashMap<int,int,Hashint> b;
+            for(int i=0;i<keyRange;i+=2)
+            {
+                a.put(i,i);
+                b.put(i,i);
+            }
+            double ra=runMix(a,threads,mixes[m]);
+            double rb=runMix(b,threads,mixes[m]);
+            printf("%8d %16.0f %16.0f\n",threads,ra,rb);
+        }
+    }
+}
+
+//----------------------bench HashMap allocators--------------------------
+
+template <template <class> class A>
+double buildAndDrop(int maps,int entries)
+{
+    double t=timeIt([&]()
+    {
+        for(int i=0;i<maps;++i)
+        {
+            HashMap<int,int,Hashint,A> map;
+            for(int j=0;j<entries;++j)map.put(j*7,j);
+            for(int j=0;j<entries;++j)map.containsKey(j);
+        }
+    });
+    return maps/t;
+}
+
+void benchArenaHash()
+{
+    cout<<"Bench HashMap allocators"<<endl;
+    printf("%8s %16s %16s\n","entries","heap maps/s","arena maps/s");
+    for(int entries=16;entries<=4096;entries*=4)
+    {
+        int maps=(1<<22)/entries;
+        printf("%8d %16.0f %16.0f\n",entries,buildAndDrop<HeapAllocator>(maps,entries),
+               buildAndDrop<ArenaAllocator>(maps,entries));
+    }
+}
+
+//----------------------bench HashMap batches--------------------------
+
+void benchBatchHash()
+{
+    cout<<"Bench HashMap batches"<<endl;
+    const int n=1<<22,probes=1<<22;
+    vector<pair<int,int> > data;
+    for(int i=0;i<n;++i)data.push_back(make_pair(i*2,i));
+    HashMap<int,int,Hashint> a,b;
+    double ta=timeIt([&](){ for(int i=0;i<n;++i)a.put(data[i].first,data[i].second); });
+    double tb=timeIt([&](){ b.putAll(data.begin(),data.end()); });
+    printf("%-24s %16.0f %16.0f\n","build put/putAll",n/ta,n/tb);
+    unsigned int seed=12345;
+    vector<int> keys(probes);
+    for(int i=0;i<probes;++i)keys[i]=Rand(seed)%(2*n);
+    vector<const int *> out(probes);
+    long long found=0;
+    ta=timeIt([&](){ for(int i=0;i<probes;++i)found+=a.containsKey(keys[i]); });
+    tb=timeIt([&](){ found-=b.getBatch(keys.data(),probes,out.data()); });
+    printf("%-24s %16.0f %16.0f\n","probe get/getBatch",probes/ta,probes/tb);
+    if(found)cout<<"mismatch"<<endl;
+}
+
+//----------------------bench HashMap misses--------------------------
+
+void benchMissHash()
+{
+    cout<<"Bench HashMap misses"<<endl;
+    const int n=1<<20,probes=1<<20;
+    HashMap<int,int,Hashint> a,b;
+    b.setFilter(true);
+    for(int i=0;i<n;++i)
+    {
+        a.put(i*10,i);
+        b.put(i*10,i);
+    }
+    unsigned int seed=4321;
+    vector<int> keys(probes);
+    for(int i=0;i<probes;++i)keys[i]=(Rand(seed)%100<90)?(int)(Rand(seed)%(10*n))|1:(int)(Rand(seed)%n)*10;
+    long long sum[3]={0,0,0};
+    double t0=timeIt([&]()
+    {
+        for(int i=0;i<probes;++i)
+        {
+            try
+            {
+                sum[0]+=a.get(keys[i]);
+            }catch(ElementNotExist)
+            {
+            }
+        }
+    });
+    double t1=timeIt([&](){ for(int i=0;i<probes;++i){ const int *p=a.find(keys[i]); if(p)sum[1]+=*p; } });
+    double t2=timeIt([&](){ for(int i=0;i<probes;++i){ const int *p=b.find(keys[i]); if(p)sum[2]+=*p; } });
+    printf("%-24s %16s %16s %16s\n","90% misses","get/catch","find","find+filter");
+    printf("%-24s %16.0f %16.0f %16.0f\n","lookups/s",probes/t0,probes/t1,probes/t2);
+    if(sum[0]!=sum[1] || sum[1]!=sum[2])cout<<"mismatch"<<endl;
+}
+
+//----------------------bench TreeMap backends--------------------------
+
+template <class M>
+void orderedRun(const char *name,const vector<int> &keys)
+{
+    M a;
+    int n=keys.size();
+    long long sum=0;
+    double t0=timeIt([&](){ for(int i=0;i<n;++i)a.put(keys[i],i); });
+    double t1=timeIt([&](){ for(int i=0;i<n;++i)sum+=a.get(keys[(i*7)%n]); });
+    double t2=timeIt([&]()
+    {
+        auto it=a.iterator();
+        while(it.hasNext())sum+=it.next().getValue();
+    });
+    double t3=timeIt([&](){ for(int i=0;i<n;++i)a.remove(keys[i]); });
+    printf("%-24s %16.0f %16.0f %16.0f %16.0f\n",name,n/t0,n/t1,n/t2,n/t3);
+    if(sum==42)cout<<"";
+}
+
+void benchTreeMaps()
+{
+    cout<<"Bench TreeMap backends"<<endl;
+    const int n=1<<20;
+    unsigned int seed=777;
+    vector<int> keys(n);
+    for(int i=0;i<n;++i)keys[i]=i;
+    for(int i=n-1;i>0;--i)swap(keys[i],keys[Rand(seed)%(i+1)]);
+    printf("%-24s %16s %16s %16s %16s\n","ops/s","put","get","iterate","remove");
+    orderedRun<TreeMap<int,int> >("TreeMap",keys);
+    orderedRun<TreeMap<int,int,NoAggregate<int,int>,ArenaAllocator> >("TreeMap arena",keys);
+    orderedRun<BTreeMap<int,int> >("BTreeMap",keys);
+}
+
+//----------------------bench ConcurrentTreeMap--------------------------
+
+/**
+ * A TreeMap behind a reader-writer lock, which is what ConcurrentTreeMap replaces.
+ */
+class RWLockedTreeMap
+{
+public:
+    RWLockedTreeMap()
+    {
+        pthread_rwlock_init(&lock,0);
+    }
+    ~RWLockedTreeMap()
+    {
+        pthread_rwlock_destroy(&lock);
+    }
+    bool containsKey(int key)
+    {
+        pthread_rwlock_rdlock(&lock);
+        bool res=map.containsKey(key);
+        pthread_rwlock_unlock(&lock);
+        return res;
+    }
+    void put(int key,int value)
+    {
+        pthread_rwlock_wrlock(&lock);
+        map.put(key,value);
+        pthread_rwlock_unlock(&lock);
+    }
+private:
+    pthread_rwlock_t lock;
+    TreeMap<int,int> map;
+};
+
+/**
+ * readers threads look up keys while 2 writers keep putting, returns the lookups per second.
+ */
+template <class M>
+double runReaders(M &map,int readers)
+{
+    vector<thread> workers;
+    atomic<bool> done(false);
+    for(int i=0;i<2;++i)
+        workers.push_back(thread([&map,&done,i]()
+        {
+            unsigned int seed=i*104729+3;
+            while(!done)map.put(Rand(seed)%keyRange,i);
+        }));
+    double t=timeIt([&]()
+    {
+        vector<thread> reading;
+        for(int i=0;i<readers;++i)
+            reading.push_back(thread([&map,i]()
+            {
+                unsigned int seed=i*7919+1;
+                for(int j=0;j<opsPerThread;++j)map.containsKey(Rand(seed)%keyRange);
+            }));
+        for(auto &w:reading)w.join();
+    });
+    done=true;
+    for(auto &w:workers)w.join();
+    return readers*(double)opsPerThread/t;
+}
+
+void benchConcurrentTree()
+{
+    cout<<"Bench ConcurrentTreeMap"<<endl;
+    printf("2 writers\n%8s %16s %16s\n","readers","rwlock","epoch");
+    for(int readers=1;readers<=32;readers*=2)
+    {
+        RWLockedTreeMap a;
+        ConcurrentTreeMap<int,int> b;
+        for(int i=0;i<keyRange;i+=2)
+        {
+            a.put(i,i);
+            b.put(i,i);
+        }
+        double ra=runReaders(a,readers);
+        double rb=runReaders(b,readers);
+        printf("%8d %16.0f %16.0f\n",readers,ra,rb);
+    }
+}
+
+//----------------------bench PriorityQueue--------------------------
+
+/**
+ * a timer queue: n pushes, then pops each pushing a later timer, then n pops.
+ */
+template <int D>
+double runTimers(int n)
+{
+    PriorityQueue<long long,Less<long long>,D> q;
+    unsigned int seed=2024;
+    long long sum=0;
+    double t=timeIt([&]()
+    {
+        for(int i=0;i<n;++i)q.push(Rand(seed)%(10*n));
+        for(int i=0;i<n;++i)
+        {
+            long long a=q.front();
+            q.pop();
+            q.push(a+Rand(seed)%n);
+            sum+=a;
+        }
+        while(!q.empty())q.pop();
+    });
+    if(sum==42)cout<<"";
+    return 3.0*n/t;
+}
+
+void benchPriorityQueue()
+{
+    cout<<"Bench PriorityQueue"<<endl;
+    printf("%10s %16s %16s %16s\n","timers","2-ary","4-ary","8-ary");
+    for(int n=1<<16;n<=1<<22;n<<=3)printf("%10d %16.0f %16.0f %16.0f\n",n,runTimers<2>(n),runTimers<4>(n),runTimers<8>(n));
+    const int queued=1<<16;
+    printf("%10s %16s %16s\n","batch","push","pushAll");
+    for(int k=1<<10;k<=1<<20;k<<=5)
+    {
+        unsigned int seed=99;
+        vector<long long> jobs(k);
+        for(int i=0;i<k;++i)jobs[i]=Rand(seed)%(1<<30);
+        double t[2];
+        for(int m=0;m<2;++m)
+        {
+            PriorityQueue<long long> q;
+            for(int i=0;i<queued;++i)q.push(Rand(seed)%(1<<30));
+            t[m]=timeIt([&]()
+            {
+                if(m)q.pushAll(jobs.begin(),jobs.end());
+                else for(int i=0;i<k;++i)q.push(jobs[i]);
+            });
+        }
+        printf("%10d %16.0f %16.0f\n",k,k/t[0],k/t[1]);
+    }
+}
+
+//----------------------bench PairingHeap--------------------------
+
+/**
+ * Dijkstra from vertex 0 of a random graph, with decreaseKey, returns the seconds.
+ */
+template <class Q>
+double runDijkstra(const vector<vector<pair<int,int> > > &g,long long &total)
+{
+    int n=g.size();
+    vector<long long> dist(n,-1);
+    vector<typename Q::Handle> handle(n);
+    vector<bool> queued(n,false);
+    double t=timeIt([&]()
+    {
+        Q q;
+        dist[0]=0;
+        handle[0]=q.push(make_pair(0LL,0));
+        queued[0]=true;
+        while(!q.empty())
+        {
+            int u=q.front().second;
+            q.pop();
+            queued[u]=false;
+            for(size_t i=0;i<g[u].size();++i)
+            {
+                int v=g[u][i].first;
+                long long d=dist[u]+g[u][i].second;
+                if(dist[v]>=0 && dist[v]<=d)continue;
+                if(queued[v])q.decreaseKey(handle[v],make_pair(d,v));
+                else if(dist[v]<0)
+                {
+                    handle[v]=q.push(make_pair(d,v));
+                    queued[v]=true;
+                }
+                dist[v]=d;
+            }
+        }
+    });
+    total=0;
+    for(int i=0;i<n;++i)total+=dist[i];
+    return t;
+}
+
+/**
+ * workers queues of jobs each are melded two by two into one, as the idle workers
+ * steal from each other, returns the seconds taken by the melds.
+ */
+template <class Q>
+double runMelds(int workers,int jobs)
+{
+    unsigned int seed=31;
+    vector<Q> queues(workers);
+    for(int w=0;w<workers;++w)
+        for(int j=0;j<jobs;++j)queues[w].push(Rand(seed)%(1<<30));
+    return timeIt([&]()
+    {
+        for(int step=1;step<workers;step*=2)
+            for(int w=0;w+step<workers;w+=2*step)meldInto(queues[w],queues[w+step]);
+    });
+}
+
+template <class V>
+void meldInto(PriorityQueue<V> &a,PriorityQueue<V> &b)
+{
+    a.merge(std::move(b));
+}
+
+template <class V>
+void meldInto(PairingHeap<V> &a,PairingHeap<V> &b)
+{
+    a.meld(std::move(b));
+}
+
+void benchPairingHeap()
+{
+    cout<<"Bench PairingHeap"<<endl;
+    const int n=1<<18;
+    unsigned int seed=4242;
+    vector<vector<pair<int,int> > > g(n);
+    for(int i=0;i<8*n;++i)g[Rand(seed)%n].push_back(make_pair(Rand(seed)%n,Rand(seed)%1000+1));
+    long long ta,tb;
+    double t0=runDijkstra<PriorityQueue<pair<long long,int> > >(g,ta);
+    double t1=runDijkstra<PairingHeap<pair<long long,int> > >(g,tb);
+    printf("%-24s %16s %16s\n","seconds","PriorityQueue","PairingHeap");
+    printf("%-24s %16.3f %16.3f\n","dijkstra",t0,t1);
+    printf("%-24s %16.3f %16.3f\n","melds of 64x16384 jobs",runMelds<PriorityQueue<long long> >(64,1<<14),
+           runMelds<PairingHeap<long long> >(64,1<<14));
+    if(ta!=tb)cout<<"mismatch"<<endl;
+}
+
+//----------------------bench MonotonePriorityQueue--------------------------
+
+/**
+ * the timer queue of runTimers, whose keys never go back, returns the operations
+ * per second.
+ */
+template <class Q>
+double runMonotoneTimers(int n)
+{
+    Q q;
+    unsigned int seed=2024;
+    unsigned long long sum=0;
+    double t=timeIt([&]()
+    {
+        for(int i=0;i<n;++i)q.push(Rand(seed)%(10*n));
+        for(int i=0;i<n;++i)
+        {
+            unsigned long long a=q.front();
+            q.pop();
+            q.push(a+Rand(seed)%n);
+            sum+=a;
+        }
+        while(!q.empty())q.pop();
+    });
+    if(sum==42)cout<<"";
+    return 3.0*n/t;
+}
+
+/**
+ * Dijkstra from vertex 0 without decreaseKey: the distance and the vertex are
+ * packed in one key, and stale keys are skipped. Returns the seconds.
+ */
+template <class Q>
+double runPackedDijkstra(const vector<vector<pair<int,int> > > &g,long long &total)
+{
+    int n=g.size();
+    vector<long long> dist(n,-1);
+    double t=timeIt([&]()
+    {
+        Q q;
+        dist[0]=0;
+        q.push(0);
+        while(!q.empty())
+        {
+            unsigned long long key=q.front();
+            q.pop();
+            int u=key&((1<<20)-1);
+            if((long long)(key>>20)!=dist[u])continue;
+            for(size_t i=0;i<g[u].size();++i)
+            {
+                int v=g[u][i].first;
+                long long d=dist[u]+g[u][i].second;
+                if(dist[v]>=0 && dist[v]<=d)continue;
+                dist[v]=d;
+                q.push((unsigned long long)d<<20|v);
+            }
+        }
+    });
+    total=0;
+    for(int i=0;i<n;++i)total+=dist[i];
+    return t;
+}
+
+void benchMonotoneQueue()
+{
+    cout<<"Bench MonotonePriorityQueue"<<endl;
+    printf("%10s %16s %16s %16s\n","timers","2-ary","4-ary","radix");
+    for(int n=1<<16;n<=1<<22;n<<=3)
+        printf("%10d %16.0f %16.0f %16.0f\n",n,runMonotoneTimers<PriorityQueue<unsigned long long,Less<unsigned long long>,2> >(n),
+               runMonotoneTimers<PriorityQueue<unsigned long long> >(n),runMonotoneTimers<MonotonePriorityQueue<> >(n));
+    const int n=1<<18;
+    unsigned int seed=4242;
+    vector<vector<pair<int,int> > > g(n);
+    for(int i=0;i<8*n;++i)g[Rand(seed)%n].push_back(make_pair(Rand(seed)%n,Rand(seed)%1000+1));
+    long long ta,tb,tc;
+    double t0=runPackedDijkstra<PriorityQueue<unsigned long long,Less<unsigned long long>,2> >(g,ta);
+    double t1=runPackedDijkstra<PriorityQueue<unsigned long long> >(g,tb);
+    double t2=runPackedDijkstra<MonotonePriorityQueue<> >(g,tc);
+    printf("%10s %16.3f %16.3f %16.3f\n","dijkstra s",t0,t1,t2);
+    if(ta!=tb || tb!=tc)cout<<"mismatch"<<endl;
+}
+
+//-----------------------------------------------------------
+
+int main()
+{
+    benchConcurrentHash();
+    benchArenaHash();
+    benchBatchHash();
+    benchMissHash();
+    benchTreeMaps();
+    benchConcurrentTree();
+    benchPriorityQueue();
+    benchPairingHeap();
+    benchMonotoneQueue();
+    return 0;
+}
@@ -1,15 +1,30 @@
 #include "LinkedList.h"
 #include "ArrayList.h"
 #include "HashMap.h"
+#include "HashSet.h"
+#include "HashMultiMap.h"
+#include "MappedHashMap.h"
+#include "ConcurrentHashMap.h"
 #include "TreeMap.h"
+#include "BTreeMap.h"
+#include "ConcurrentTreeMap.h"
 #include "Deque.h"
 #include "PriorityQueue.h"
+#include "PairingHeap.h"
+#include "MonotonePriorityQueue.h"
 #include "ElementNotExist.h"
 #include "IndexOutOfBound.h"
 #include "queue"
 #include "set"
 #include "iostream"
 #include "algorithm"
+#include "climits"
+#include "cstdio"
+#include "cstring"
+#include "string"
+#include "vector"
+#include "map"
+#include "list"
 using namespace std;
 typedef pair<int, int> PII;
 
@@ -357,6 +372,1106 @@ void testHeap2()
     puts("Done heap test 2");
 }
 
+class Hashint
+{
+public:
+    static int hashCode(int obj)
+    {
+        return obj;
+    }
+};
+
+void testHashMin()
+{
+    HashMap<int,int,Hashint> m;
+    HashSet<int,Hashint> s;
+    HashMultiMap<int,int,Hashint> mm;
+    for(int i=0;i<100;i++)
+    {
+        m.put(INT_MIN+i,i);
+        s.add(INT_MIN+i);
+        mm.put(INT_MIN+i,i);
+        mm.put(INT_MIN+i,-i);
+    }
+    m.put(INT_MAX,-1);
+    cout<<m.size()<<' '<<s.size()<<' '<<mm.size()<<endl;
+    cout<<m.get(INT_MIN)<<' '<<m.get(INT_MIN+99)<<' '<<m.get(INT_MAX)<<endl;
+    cout<<s.contains(INT_MIN)<<' '<<mm.count(INT_MIN)<<endl;
+    m.remove(INT_MIN);
+    s.remove(INT_MIN);
+    mm.remove(INT_MIN);
+    cout<<m.containsKey(INT_MIN)<<' '<<s.contains(INT_MIN)<<' '<<mm.containsKey(INT_MIN)<<endl;
+    puts("Done hash INT_MIN test");
+}
+
+static string readFile(const char *path)
+{
+    string res;
+    FILE *f=fopen(path,"rb");
+    if(!f)return res;
+    char buf[4096];
+    size_t n;
+    while((n=fread(buf,1,sizeof(buf),f))>0)res.append(buf,n);
+    fclose(f);
+    return res;
+}
+
+void testMapped()
+{
+    const char *path="mytest_mapped.bin";
+    HashMap<int,long long,Hashint> h;
+    for(int i=0;i<1000;i++)h.put(i*7-3000,(long long)i*i);
+    h.put(INT_MIN,-5);
+    h.saveTo(path);
+    string first=readFile(path);
+    HashMap<int,long long,Hashint> h2(h);
+    h2.saveTo(path);
+    cout<<(first==readFile(path))<<endl;
+    MappedHashMap<int,long long,Hashint> m;
+    cout<<m.open(path)<<' '<<m.size()<<endl;
+    long long sum=0;
+    for(int i=0;i<1000;i++)sum+=m.get(i*7-3000);
+    cout<<sum<<' '<<m.get(INT_MIN)<<' '<<m.containsKey(1)<<endl;
+    m.close();
+    // the bucket table follows the 40-byte header, break its order: open() must refuse the file
+    string broken=first;
+    int word;
+    size_t at=40+4*5;
+    memcpy(&word,&broken[at],sizeof(int));
+    word+=100000;
+    memcpy(&broken[at],&word,sizeof(int));
+    FILE *f=fopen(path,"wb");
+    fwrite(broken.data(),1,broken.size(),f);
+    fclose(f);
+    cout<<m.open(path)<<' '<<m.size()<<' '<<m.containsKey(0)<<endl;
+    remove(path);
+    puts("Done mapped test");
+}
+
+void testConcurrentHash()
+{
+    ConcurrentHashMap<int,int,Hashint> c(4);
+    cout<<c.putIfAbsent(1,10)<<' '<<c.putIfAbsent(1,11)<<' '<<c.get(1)<<endl;
+    bool present=c.computeIfPresent(1,[](int x){ return x*3; });
+    bool absent=c.computeIfPresent(2,[](int x){ return x; });
+    cout<<present<<' '<<absent<<' '<<c.get(1)<<' '<<c.containsKey(2)<<' '<<c.size()<<endl;
+    for(int i=0;i<1000;i++)c.put(i,i);
+    c.remove(500);
+    cout<<c.size()<<' '<<c.containsKey(500)<<' '<<c.get(999)<<endl;
+    c.clear();
+    cout<<c.isEmpty()<<' '<<c.containsKey(1)<<endl;
+    puts("Done concurrent hash test");
+}
+
+class Hashstr
+{
+public:
+    typedef void is_transparent;
+    static int hashCode(const string &s)
+    {
+        return hashCode(s.c_str());
+    }
+    static int hashCode(const char *s)
+    {
+        int h=0;
+        while(*s)h=h*31+*s++;
+        return h;
+    }
+};
+
+void testHashAccess()
+{
+    HashMap<string,int,Hashstr> h;
+    h.put("one",1);
+    h.put("two",2);
+    cout<<h.get("one")<<' '<<h.containsKey("two")<<' '<<h.containsKey("three")<<endl;
+    h.getOrInsert("three")+=3;
+    h.getOrInsert("one")+=10;
+    int calls=0;
+    h.computeIfAbsent("four",[&](const string &k){ calls++; return (int)k.size(); });
+    h.computeIfAbsent("four",[&](const string &k){ calls++; return 0; });
+    const char *words[]={"a","b","a","c","a","b"};
+    HashMap<string,int,Hashstr> count;
+    for(int i=0;i<6;i++)count.merge(words[i],1,[](int x,int y){ return x+y; });
+    cout<<h.get("three")<<' '<<h.get("one")<<' '<<h.get("four")<<' '<<calls<<endl;
+    cout<<count.get("a")<<' '<<count.get("b")<<' '<<count.get("c")<<' '<<count.size()<<endl;
+    puts("Done hash access test");
+}
+
+void testHashArena()
+{
+    HashMap<int,string,Hashint,ArenaAllocator> h;
+    HashMap<int,int,Hashint,ArenaAllocator> g;
+    for(int round=0;round<3;round++)
+    {
+        for(int i=0;i<5000;i++)
+        {
+            h.put(i,string(i%50,'x'));
+            g.put(i*3,i);
+        }
+        for(int i=0;i<5000;i+=2)
+        {
+            h.remove(i);
+            g.remove(i*3);
+        }
+        long long len=0;
+        for(auto it=h.iterator();it.hasNext();)len+=it.next().getValue().size();
+        cout<<h.size()<<' '<<g.size()<<' '<<len<<' '<<g.get(2997)<<endl;
+        h.clear();
+        g.clear();
+    }
+    HashMap<int,int,Hashint,ArenaAllocator> k;
+    for(int i=0;i<100;i++)k.put(i,i);
+    HashMap<int,int,Hashint,ArenaAllocator> l(k);
+    k.clear();
+    cout<<l.size()<<' '<<l.get(99)<<' '<<k.size()<<endl;
+    puts("Done hash arena test");
+}
+
+class Hashbad
+{
+public:
+    static int hashCode(int obj)
+    {
+        return obj&3;
+    }
+};
+
+void testHashBatch()
+{
+    vector<pair<int,int> > data;
+    for(int i=0;i<1000;i++)data.push_back(make_pair(i*5,i));
+    HashMap<int,int,Hashint> h;
+    h.put(0,-1);
+    h.putAll(data.begin(),data.end());
+    int keys[2000];
+    for(int i=0;i<2000;i++)keys[i]=i*5/2;
+    const int *out[2000];
+    bool in[2000];
+    int found=h.getBatch(keys,2000,out),found2=h.containsBatch(keys,2000,in);
+    long long sum=0;
+    int agree=1;
+    for(int i=0;i<2000;i++)
+    {
+        if(out[i])sum+=*out[i];
+        if(in[i]!=(out[i]!=0) || in[i]!=h.containsKey(keys[i]))agree=0;
+    }
+    cout<<h.size()<<' '<<found<<' '<<found2<<' '<<sum<<' '<<agree<<endl;
+    HashMap<int,int,Hashbad> bad;
+    bad.putAll(data.begin(),data.end());
+    cout<<bad.getBatch(keys,2000,out)<<' '<<bad.get(4995)<<endl;
+    puts("Done hash batch test");
+}
+
+void testHashStats()
+{
+    HashMap<int,int,Hashbad> h;
+    for(int i=0;i<1000;i++)h.put(i,i);
+    auto s=h.stats();
+    int buckets=0,entries=0;
+    for(int i=0;i<s.maxChains;i++)buckets+=s.chains[i];
+    for(int i=0;i+1<s.maxChains;i++)entries+=i*s.chains[i];
+    cout<<s.size<<' '<<(buckets==s.capacity)<<' '<<(s.emptyBuckets==s.chains[0])<<' ';
+    cout<<(s.capacity-s.emptyBuckets)<<' '<<s.longestChain<<' '<<s.chains[s.maxChains-1]<<' '<<entries<<endl;
+    cout<<(s.loadFactor==(double)s.size/s.capacity)<<' '<<(s.averageProbe>=1)<<' '<<s.lookups<<' '<<s.probes<<endl;
+    HashMap<int,int,Hashint> empty;
+    auto e=empty.stats();
+    cout<<e.size<<' '<<e.longestChain<<' '<<(e.emptyBuckets==e.capacity)<<endl;
+    puts("Done hash stats test");
+}
+
+void testHashSetMulti()
+{
+    HashSet<int,Hashint> s;
+    cout<<s.add(1)<<' '<<s.add(1)<<' '<<s.add(2)<<' '<<s.size()<<endl;
+    int keys[]={1,2,3};
+    bool in[3];
+    cout<<s.containsBatch(keys,3,in)<<' '<<in[0]<<in[1]<<in[2]<<endl;
+    cout<<s.remove(1)<<' '<<s.remove(1)<<' '<<s.contains(1)<<' '<<s.size()<<endl;
+    HashMultiMap<int,int,Hashint> m;
+    m.put(1,10);
+    m.put(1,11);
+    m.put(1,10);
+    m.put(2,20);
+    cout<<m.size()<<' '<<m.keyCount()<<' '<<m.count(1)<<' '<<m.containsEntry(1,11)<<' '<<m.containsEntry(2,21)<<endl;
+    cout<<m.remove(1,10)<<' '<<m.count(1)<<' '<<m.remove(1,12)<<' '<<m.remove(3,1)<<endl;
+    cout<<m.remove(2,20)<<' '<<m.containsKey(2)<<' '<<m.keyCount()<<' '<<m.size()<<endl;
+    m.remove(1);
+    cout<<m.isEmpty()<<' '<<m.count(1)<<endl;
+    try
+    {
+        m.remove(1);
+    }catch(ElementNotExist e)
+    {
+        cout<<"remove OK"<<endl;
+    }
+    puts("Done hash set test");
+}
+
+void testHashFind()
+{
+    HashMap<string,int,Hashstr> h;
+    h.put("two",2);
+    int v=-1;
+    cout<<(h.find("two")!=0)<<' '<<(h.find("five")==0)<<' '<<h.tryGet("two",v)<<' '<<v;
+    cout<<' '<<h.tryGet("five",v)<<' '<<v<<endl;
+    *h.find("two")=20;
+    const HashMap<string,int,Hashstr> &c=h;
+    cout<<h.get("two")<<' '<<*c.find("two")<<' '<<(c.find("five")==0)<<endl;
+    puts("Done hash find test");
+}
+
+/**
+ * a map with the filter and one without it go through the same operations,
+ * including removals past the rebuild of the filter, clear, copy and growth.
+ */
+void testHashFilter()
+{
+    HashMap<int,int,Hashint> a,b;
+    b.setFilter(true);
+    int wrong=0;
+    for(int round=0;round<3;round++)
+    {
+        for(int i=0;i<20000;i++)
+        {
+            int key=Rand()*4+round;
+            if(Rand()%3)
+            {
+                a.put(key,i);
+                b.put(key,i);
+            }else if(a.containsKey(key))
+            {
+                a.remove(key);
+                b.remove(key);
+            }
+        }
+        for(int key=0;key<65537*4;key++)
+        {
+            const int *x=a.find(key),*y=b.find(key);
+            if((x==0)!=(y==0) || (x && *x!=*y))wrong++;
+        }
+        cout<<a.size()<<' '<<b.size()<<' '<<wrong<<endl;
+        if(round==0)
+        {
+            HashMap<int,int,Hashint> c(b);
+            b=c;
+        }
+        if(round==1)
+        {
+            a.clear();
+            b.clear();
+            cout<<b.containsKey(4)<<' '<<(b.find(5)==0)<<endl;
+        }
+    }
+    vector<int> keys;
+    for(auto it=a.iterator();it.hasNext();)keys.push_back(it.next().getKey());
+    for(int i=0;i+10<(int)keys.size();i++)
+    {
+        a.remove(keys[i]);
+        b.remove(keys[i]);
+    }
+    for(int key=0;key<65537*4;key++)
+        if(a.containsKey(key)!=b.containsKey(key))wrong++;
+    cout<<a.size()<<' '<<b.size()<<' '<<wrong<<endl;
+    puts("Done hash filter test");
+}
+
+template <class M>
+long long sumTree(const M &t)
+{
+    long long sum=0;
+    for(auto it=t.iterator();it.hasNext();)
+    {
+        auto &e=it.next();
+        sum+=e.getKey()*1000LL+e.getValue().size();
+    }
+    return sum;
+}
+
+/**
+ * split and join move mappings between maps; with an arena each map must keep
+ * its own nodes, so the maps survive each other.
+ */
+void testTreeArenaMoves()
+{
+    typedef TreeMap<int,string,NoAggregate<int,string>,ArenaAllocator> ArenaTree;
+    ArenaTree a;
+    for(int i=0;i<100;i++)a.put(i,string(i%7,'a'));
+    {
+        ArenaTree b;
+        for(int i=100;i<200;i++)b.put(i,string(i%5,'b'));
+        a.join(b);
+        cout<<a.size()<<' '<<b.size()<<endl;
+    }
+    cout<<sumTree(a)<<endl;
+    {
+        ArenaTree c;
+        for(int i=150;i<250;i++)c.put(i,"c");
+        a.join(c);
+    }
+    cout<<a.size()<<' '<<sumTree(a)<<endl;
+    ArenaTree right;
+    {
+        ArenaTree d(a);
+        d.split(120,right);
+        cout<<d.size()<<' '<<right.size()<<' '<<d.lastKey()<<' '<<right.firstKey()<<endl;
+    }
+    right.put(1000,"x");
+    cout<<sumTree(right)<<endl;
+    {
+        ArenaTree e;
+        right.split(200,e);
+        right.join(e);
+    }
+    cout<<right.size()<<' '<<sumTree(right)<<endl;
+    puts("Done tree arena test");
+}
+
+template <class T>
+bool sameAs(const T &t,const map<int,int> &m)
+{
+    if(t.size()!=(int)m.size())return 0;
+    auto it=t.iterator();
+    for(auto &e:m)
+    {
+        if(!it.hasNext())return 0;
+        auto &x=it.next();
+        if(x.getKey()!=e.first || x.getValue()!=e.second)return 0;
+    }
+    return !it.hasNext();
+}
+
+template <class T>
+void randomTree(T &t,map<int,int> &m,int n,int range)
+{
+    for(int i=0;i<n;i++)
+    {
+        int key=Rand()%range;
+        if(Rand()%4)
+        {
+            t.put(key,i);
+            m[key]=i;
+        }else if(m.count(key))
+        {
+            t.remove(key);
+            m.erase(key);
+        }
+    }
+}
+
+void testTreeRank()
+{
+    TreeMap<int,int> t;
+    map<int,int> m;
+    randomTree(t,m,3000,5000);
+    int wrong=!sameAs(t,m);
+    for(int key=-1;key<=5001;key+=7)
+    {
+        auto lb=m.lower_bound(key);
+        if(t.rank(key)!=(int)distance(m.begin(),lb))wrong++;
+        if(t.countRange(key,key+500)!=(int)distance(lb,m.lower_bound(key+500)))wrong++;
+    }
+    int k=0;
+    for(auto &e:m)
+        if(t.select(k++).getKey()!=e.first)wrong++;
+    cout<<m.size()<<' '<<wrong<<endl;
+    cout<<t.countRange(2000,1000)<<' '<<t.countRange(7,7)<<' '<<t.rank(-5)<<' '<<(t.rank(6000)==t.size())<<endl;
+    int num=0;
+    try{ t.select(t.size()); }catch(IndexOutOfBound e){ num++; }
+    try{ t.select(-1); }catch(IndexOutOfBound e){ num++; }
+    cout<<num<<endl;
+    puts("Done tree rank test");
+}
+
+void testTreeIterate()
+{
+    TreeMap<int,int> t;
+    map<int,int> m;
+    randomTree(t,m,3000,5000);
+    int wrong=!sameAs(t,m);
+    auto d=t.descendingIterator();
+    for(auto e=m.rbegin();e!=m.rend();++e)
+        if(!d.hasNext() || d.next().getKey()!=e->first)wrong++;
+    if(d.hasNext())wrong++;
+    TreeMap<int,int> chain;
+    for(int i=0;i<100000;i++)chain.put(i,i);
+    long long sum=0;
+    for(auto it=chain.iterator();it.hasNext();)sum+=it.next().getValue();
+    cout<<m.size()<<' '<<wrong<<' '<<sum<<endl;
+    TreeMap<int,int> e;
+    try{ e.descendingIterator().next(); }catch(ElementNotExist e){ cout<<"next OK"<<endl; }
+    puts("Done tree iterate test");
+}
+
+/**
+ * the navigation and the views against map.
+ */
+void testTreeNavigate()
+{
+    TreeMap<int,int> t;
+    map<int,int> m;
+    randomTree(t,m,3000,5000);
+    int wrong=0;
+    for(int key=-1;key<=5001;key+=7)
+    {
+        auto lb=m.lower_bound(key);
+        if(lb!=m.end() && t.ceilingKey(key)!=lb->first)wrong++;
+        auto ub=m.upper_bound(key);
+        if(ub!=m.end() && t.higherKey(key)!=ub->first)wrong++;
+        if(lb!=m.begin() && t.lowerKey(key)!=prev(lb)->first)wrong++;
+        if(ub!=m.begin() && t.floorEntry(key).getValue()!=prev(ub)->second)wrong++;
+        if(t.subMap(key,key+500).size()!=(int)distance(lb,m.lower_bound(key+500)))wrong++;
+    }
+    auto view=t.subMap(1000,2000);
+    int inView=0;
+    for(auto it=view.iterator();it.hasNext();inView++)
+    {
+        int key=it.next().getKey();
+        if(key<1000 || key>=2000)wrong++;
+    }
+    int back=0;
+    for(auto it=t.headMap(100).descendingIterator();it.hasNext();back++)it.next();
+    cout<<m.size()<<' '<<wrong<<' '<<inView<<' '<<view.size()<<' '<<back<<' '<<t.tailMap(4900).size()<<endl;
+    cout<<t.subMap(2000,1000).size()<<' '<<t.subMap(2000,1000).iterator().hasNext()<<endl;
+    cout<<t.firstKey()<<' '<<t.lastKey()<<' '<<t.pollFirst().getKey()<<' '<<t.pollLast().getKey()<<' '<<t.size()<<endl;
+    int num=0;
+    try{ t.lowerKey(t.firstKey()); }catch(ElementNotExist e){ num++; }
+    try{ t.higherEntry(t.lastKey()); }catch(ElementNotExist e){ num++; }
+    try{ view.get(2500); }catch(ElementNotExist e){ num++; }
+    TreeMap<int,int> e;
+    try{ e.pollFirst(); }catch(ElementNotExist e){ num++; }
+    cout<<num<<endl;
+    puts("Done tree navigate test");
+}
+
+void testTreeMutate()
+{
+    TreeMap<int,int> t;
+    map<int,int> m;
+    randomTree(t,m,20000,3000);
+    int wrong=!sameAs(t,m);
+    for(int i=0;i<3000;i+=13)
+    {
+        bool has=0;
+        for(auto &e:m)has|=e.second==i;
+        if(t.containsValue(i)!=has)wrong++;
+    }
+    cout<<m.size()<<' '<<wrong<<endl;
+    for(int i=0;i<100000;i++)t.put(-i,i);
+    for(int i=0;i<100000;i+=2)t.remove(-i);
+    cout<<t.size()<<' '<<t.get(-99999)<<' '<<t.containsKey(-2)<<endl;
+    t.clear();
+    cout<<t.isEmpty()<<' '<<t.containsValue(0)<<endl;
+    try{ t.remove(1); }catch(ElementNotExist e){ cout<<"remove OK"<<endl; }
+    puts("Done tree mutate test");
+}
+
+/**
+ * BTreeMap grows and shrinks through splits, borrows and merges of its nodes.
+ */
+void testBTree()
+{
+    BTreeMap<int,int> b;
+    BTreeMap<string,int> bs;
+    map<int,int> m;
+    int wrong=0;
+    for(int i=0;i<30000;i++)
+    {
+        int key=Rand()%8000;
+        if(Rand()%3)
+        {
+            b.put(key,i);
+            m[key]=i;
+        }else if(m.count(key))
+        {
+            b.remove(key);
+            m.erase(key);
+        }
+        if(i==20000)
+        {
+            BTreeMap<int,int> copy(b);
+            wrong+=!sameAs(copy,m);
+        }
+    }
+    wrong+=!sameAs(b,m);
+    for(int key=0;key<8000;key++)
+        if(b.containsKey(key)!=(m.count(key)>0))wrong++;
+    for(int i=0;i<5000;i++)
+    {
+        char buf[16];
+        sprintf(buf,"k%05d",i*7%5000);
+        bs.put(buf,i);
+    }
+    for(int i=0;i<5000;i+=2)
+    {
+        char buf[16];
+        sprintf(buf,"k%05d",i);
+        bs.remove(buf);
+    }
+    string prev;
+    for(auto it=bs.iterator();it.hasNext();)
+    {
+        string key=it.next().getKey();
+        if(key<=prev)wrong++;
+        prev=key;
+    }
+    cout<<b.size()<<' '<<bs.size()<<' '<<wrong<<endl;
+    puts("Done btree test");
+}
+
+void testTreeSeed()
+{
+    TreeMap<int,int> a(7),b(0);
+    map<int,int> m;
+    for(int i=0;i<5000;i++)
+    {
+        int key=Rand()%3000;
+        a.put(key,i);
+        b.put(key,i);
+        m[key]=i;
+        if(i==2500)b.setSeed(12345);
+    }
+    TreeMap<int,int> c(a);
+    c.setSeed(0);
+    c.put(-1,-1);
+    cout<<m.size()<<' '<<sameAs(a,m)<<' '<<sameAs(b,m)<<' '<<c.size()<<endl;
+    puts("Done tree seed test");
+}
+
+/**
+ * the bulk load, split, join and the set operations, also on overlapping maps and
+ * on the map itself.
+ */
+void testTreeSetOps()
+{
+    vector<pair<int,int> > sorted;
+    for(int i=0;i<1000;i++)sorted.push_back(make_pair(i*2,i));
+    TreeMap<int,int> a=TreeMap<int,int>::fromSorted(sorted.begin(),sorted.end());
+    map<int,int> ma(sorted.begin(),sorted.end());
+    TreeMap<int,int> b;
+    map<int,int> mb;
+    for(int i=0;i<1000;i++)
+    {
+        b.put(i*3,-i);
+        mb[i*3]=-i;
+    }
+    int wrong=!sameAs(a,ma);
+    TreeMap<int,int> u(a),n(a),df(a);
+    map<int,int> mu=ma,mn,md;
+    u.unionWith(b);
+    for(auto &e:mb)mu[e.first]=e.second;
+    n.intersectWith(b);
+    df.differenceWith(b);
+    for(auto &e:ma)
+    {
+        if(mb.count(e.first))mn.insert(e);
+        else md.insert(e);
+    }
+    wrong+=!sameAs(u,mu)+!sameAs(n,mn)+!sameAs(df,md)+!sameAs(a,ma)+!sameAs(b,mb);
+    cout<<u.size()<<' '<<n.size()<<' '<<df.size()<<' '<<wrong<<endl;
+    TreeMap<int,int> self(a);
+    self.unionWith(self);
+    wrong+=!sameAs(self,ma);
+    self.intersectWith(self);
+    wrong+=!sameAs(self,ma);
+    self.differenceWith(self);
+    cout<<self.size()<<' '<<self.isEmpty()<<' '<<wrong<<endl;
+    TreeMap<int,int> left(u),right;
+    right.put(-5,5);
+    left.split(1500,right);
+    map<int,int> ml(mu.begin(),mu.lower_bound(1500)),mr(mu.lower_bound(1500),mu.end());
+    wrong+=!sameAs(left,ml)+!sameAs(right,mr)+!sameAs(u,mu);
+    left.join(right);
+    wrong+=!sameAs(left,mu)+!right.isEmpty();
+    left.split(1500,left);
+    TreeMap<int,int> over;
+    over.put(10,100);
+    over.put(5000,1);
+    left.join(over);
+    mu[10]=100;
+    mu[5000]=1;
+    wrong+=!sameAs(left,mu);
+    cout<<left.size()<<' '<<over.size()<<' '<<wrong<<endl;
+    puts("Done tree set test");
+}
+
+/**
+ * copies and snapshots share their nodes: updating one must not change the other.
+ */
+void testTreeSnapshot()
+{
+    TreeMap<int,string> t;
+    for(int i=0;i<500;i++)t.put(i,string(1,'a'+i%26));
+    TreeMap<int,string> snap=t.snapshot(),copy(t);
+    for(int i=0;i<500;i+=2)t.remove(i);
+    for(int i=1;i<500;i+=4)t.put(i,"changed");
+    t.put(1000,"new");
+    TreeMap<int,string> snap2=t.snapshot();
+    copy.put(0,"copy");
+    copy.remove(499);
+    int wrong=0;
+    for(int i=0;i<500;i++)
+        if(snap.get(i)!=string(1,'a'+i%26))wrong++;
+    for(int i=1;i<500;i+=2)
+        if(snap2.get(i)!=(i%4==1?"changed":string(1,'a'+i%26)))wrong++;
+    cout<<snap.size()<<' '<<snap2.size()<<' '<<t.size()<<' '<<copy.size()<<' '<<wrong<<endl;
+    t.clear();
+    cout<<snap.get(0)<<' '<<snap2.get(1)<<' '<<copy.get(0)<<' '<<snap2.containsKey(1000)<<' '<<t.size()<<endl;
+    {
+        TreeMap<int,string> last=snap2;
+        snap2=copy;
+        last.put(2,"x");
+        cout<<last.size()<<' '<<snap2.size()<<endl;
+    }
+    puts("Done tree snapshot test");
+}
+
+/**
+ * ConcurrentTreeMap publishes a new version at every write.
+ */
+void testConcurrentTree()
+{
+    ConcurrentTreeMap<int,int> c;
+    for(int i=0;i<3000;i++)c.put(Rand()%8000,i);
+    TreeMap<int,int> snap=c.snapshot();
+    int size=c.size();
+    c.put(-1,-1);
+    c.remove(-1);
+    c.put(-2,-2);
+    int seen=0;
+    for(auto it=c.iterator();it.hasNext();seen++)it.next();
+    cout<<(snap.size()==size)<<' '<<snap.containsKey(-2)<<' '<<c.get(-2)<<' '<<c.containsKey(-1)<<' '<<(seen==size+1)<<endl;
+    c.clear();
+    cout<<c.isEmpty()<<' '<<snap.isEmpty()<<endl;
+    puts("Done concurrent tree test");
+}
+
+/**
+ * the aggregates over ranges, views and empty ranges.
+ */
+void testTreeAggregate()
+{
+    TreeMap<int,long long,SumAggregate<int,long long> > sum;
+    TreeMap<int,int,MinAggregate<int,int> > low;
+    TreeMap<int,int,MaxAggregate<int,int> > high;
+    map<int,int> m;
+    for(int i=0;i<2000;i++)
+    {
+        int key=Rand()%3000,value=Rand()%1000-500;
+        sum.put(key,value);
+        low.put(key,value);
+        high.put(key,value);
+        m[key]=value;
+        if(i%3==0)
+        {
+            int gone=Rand()%3000;
+            if(m.count(gone))
+            {
+                sum.remove(gone);
+                low.remove(gone);
+                high.remove(gone);
+                m.erase(gone);
+            }
+        }
+    }
+    int wrong=0;
+    for(int lo=-10;lo<3010;lo+=97)
+        for(int hi=lo;hi<3010;hi+=311)
+        {
+            long long s=0;
+            int mn=INT_MAX,mx=INT_MIN;
+            for(auto it=m.lower_bound(lo);it!=m.end() && it->first<hi;++it)
+            {
+                s+=it->second;
+                mn=min(mn,it->second);
+                mx=max(mx,it->second);
+            }
+            if(sum.aggregate(lo,hi)!=s || low.aggregate(lo,hi)!=mn || high.aggregate(lo,hi)!=mx)wrong++;
+            if(sum.subMap(lo,hi).aggregate()!=s)wrong++;
+        }
+    long long all=0;
+    for(auto &e:m)all+=e.second;
+    cout<<m.size()<<' '<<wrong<<' '<<(sum.aggregate()==all)<<endl;
+    cout<<sum.aggregate(500,500)<<' '<<sum.aggregate(2000,1000)<<' '<<(low.aggregate(2000,1000)==INT_MAX)<<' ';
+    cout<<(high.aggregate(10000,20000)==INT_MIN)<<' '<<sum.subMap(2000,1000).aggregate()<<endl;
+    puts("Done tree aggregate test");
+}
+
+void testTreeArena()
+{
+    TreeMap<int,string,NoAggregate<int,string>,ArenaAllocator> arena;
+    for(int round=0;round<3;round++)
+    {
+        for(int i=0;i<1000;i++)arena.put(i,string(i%10,'z'));
+        for(int i=0;i<1000;i+=3)arena.remove(i);
+        TreeMap<int,string,NoAggregate<int,string>,ArenaAllocator> other(arena);
+        other.put(-1,"neg");
+        cout<<arena.size()<<' '<<other.size()<<' '<<other.get(998)<<endl;
+        arena.clear();
+    }
+    puts("Done tree arena pool test");
+}
+
+void testTreeNoCopy()
+{
+    TreeMap<string,string> words;
+    string k="key",v="value";
+    words.put(std::move(k),std::move(v));
+    words.put(string("key"),string("again"));
+    cout<<words.get("key")<<' '<<words.size()<<endl;
+    cout<<words.emplace("e",3,'x')<<' '<<words.emplace("e",1,'y')<<' '<<words.get("e")<<endl;
+    words.getOrInsert("g")+="gg";
+    words.getOrInsert("key")+="!";
+    cout<<words.get("g")<<' '<<words.get("key")<<' '<<words.size()<<endl;
+    TreeMap<string,string> frozen=words.snapshot();
+    words.getOrInsert("g")="changed";
+    cout<<frozen.get("g")<<' '<<words.get("g")<<endl;
+    puts("Done tree no-copy test");
+}
+
+template <int D>
+int testDary()
+{
+    PriorityQueue<int,Less<int>,D> q;
+    multiset<int> m;
+    int wrong=0;
+    for(int i=0;i<20000;i++)
+    {
+        int value=Rand()%10000;
+        if(Rand()%3 || m.empty())
+        {
+            q.push(value);
+            m.insert(value);
+        }else
+        {
+            if(q.front()!=*m.begin())wrong++;
+            q.pop();
+            m.erase(m.begin());
+        }
+        if(q.size()!=(int)m.size())wrong++;
+    }
+    for(auto it=q.iterator();it.hasNext();)
+    {
+        int value=it.next();
+        if(value%2)
+        {
+            it.remove();
+            m.erase(m.find(value));
+        }
+    }
+    for(auto x:m)
+    {
+        if(q.front()!=x)wrong++;
+        q.pop();
+    }
+    return wrong+!q.empty();
+}
+
+void testDaryHeap()
+{
+    cout<<testDary<2>()<<' '<<testDary<3>()<<' '<<testDary<4>()<<' '<<testDary<8>()<<endl;
+    puts("Done d-ary heap test");
+}
+
+/**
+ * the handles follow their elements through pops, updates, erasures, iterator
+ * removals and copies; D other than 4 sifts with other widths.
+ */
+template <int D>
+int testHandles()
+{
+    PriorityQueue<int,Less<int>,D> q;
+    map<int,int> live;
+    int wrong=0,reused=0,maxHandle=-1;
+    for(int i=0;i<20000;i++)
+    {
+        int op=Rand()%8;
+        if(op<3 || live.empty())
+        {
+            int value=Rand()%10000,h=q.push(value);
+            if(live.count(h))wrong++;
+            if(h<=maxHandle)reused++;
+            maxHandle=max(maxHandle,h);
+            live[h]=value;
+        }else
+        {
+            auto it=live.begin();
+            advance(it,Rand()%live.size());
+            int value=Rand()%10000;
+            if(op==3)
+            {
+                q.update(it->first,value);
+                it->second=value;
+            }else if(op==4)
+            {
+                bool lower=value<it->second;
+                if(q.decreaseKey(it->first,value)!=lower)wrong++;
+                if(lower)it->second=value;
+            }else if(op==5)
+            {
+                q.erase(it->first);
+                if(q.contains(it->first))wrong++;
+                live.erase(it);
+            }else if(op==6)
+            {
+                int least=INT_MAX;
+                for(auto &e:live)least=min(least,e.second);
+                if(q.front()!=least)wrong++;
+                q.pop();
+                for(auto e=live.begin();e!=live.end();++e)
+                    if(!q.contains(e->first))
+                    {
+                        if(e->second!=least)wrong++;
+                        live.erase(e);
+                        break;
+                    }
+            }else
+            {
+                PriorityQueue<int,Less<int>,D> copy(q);
+                q=copy;
+            }
+        }
+        if(q.size()!=(int)live.size())wrong++;
+        if(i%500==0)
+            for(auto &e:live)
+                if(q.get(e.first)!=e.second)wrong++;
+    }
+    int num=0;
+    try{ q.get(-1); }catch(ElementNotExist e){ num++; }
+    try{ q.update(maxHandle+1,0); }catch(ElementNotExist e){ num++; }
+    q.erase(live.begin()->first);
+    try{ q.erase(live.begin()->first); }catch(ElementNotExist e){ num++; }
+    live.erase(live.begin());
+    int removed=0;
+    for(auto it=q.iterator();it.hasNext();)
+    {
+        it.next();
+        if(Rand()%3==0)
+        {
+            it.remove();
+            removed++;
+        }
+    }
+    for(auto e=live.begin();e!=live.end();)
+    {
+        if(q.contains(e->first))
+        {
+            if(q.get(e->first)!=e->second)wrong++;
+            ++e;
+        }else live.erase(e++);
+    }
+    int last=-1;
+    while(!q.empty())
+    {
+        if(q.front()<last)wrong++;
+        last=q.front();
+        q.pop();
+    }
+    return wrong+(num!=3)+(reused==0)+(removed==0)+!live.size();
+}
+
+void testHeap3()
+{
+    cout<<testHandles<2>()<<' '<<testHandles<3>()<<' '<<testHandles<4>()<<' '<<testHandles<8>()<<endl;
+    PriorityQueue<int> q;
+    int a=q.push(5),b=q.push(3);
+    q.pop();
+    int c=q.push(7);
+    cout<<(c==b)<<' '<<q.contains(a)<<' '<<q.get(a)<<' '<<q.get(c)<<endl;
+    PriorityQueue<int> copy(q);
+    copy.decreaseKey(c,1);
+    cout<<copy.front()<<' '<<q.front()<<' '<<copy.get(a)<<endl;
+    q.clear();
+    cout<<q.contains(a)<<' '<<q.push(9)<<endl;
+    puts("Done heap test 3");
+}
+
+/**
+ * small and large batches, so that both sifting up and rebuilding are taken.
+ */
+void testHeapBatch()
+{
+    int wrong=0;
+    for(int round=0;round<40;round++)
+    {
+        int n=Rand()%300,k=round%2?Rand()%5:Rand()%1000;
+        PriorityQueue<int,Less<int>,3> q;
+        multiset<int> m;
+        vector<int> handles;
+        for(int i=0;i<n;i++)
+        {
+            int value=Rand()%100;
+            handles.push_back(q.push(value));
+            m.insert(value);
+        }
+        vector<int> batch;
+        for(int i=0;i<k;i++)
+        {
+            batch.push_back(Rand()%100);
+            m.insert(batch.back());
+        }
+        if(round%4<2)q.pushAll(batch.begin(),batch.end());
+        else
+        {
+            set<int> other(batch.begin(),batch.end());
+            PriorityQueue<int,Less<int>,3> from(batch.begin(),batch.end());
+            if(from.size()!=k)wrong++;
+            q.merge(std::move(from));
+            if(!from.empty())wrong++;
+            from.push(1);
+        }
+        for(int i=0;i<n;i++)
+            if(!q.contains(handles[i]))wrong++;
+        for(auto x:m)
+        {
+            if(q.front()!=x)wrong++;
+            q.pop();
+        }
+        if(!q.empty())wrong++;
+    }
+    int data[]={5,1,4,1,3};
+    PriorityQueue<int> r(data,data+5);
+    list<int> more(3,0);
+    r.pushAll(more.begin(),more.end());
+    r.merge(std::move(r));
+    cout<<wrong<<' '<<r.size()<<' '<<r.front()<<endl;
+    puts("Done heap batch test");
+}
+
+void testPairingHeap()
+{
+    PairingHeap<int> p,other;
+    map<PairingHeap<int>::Handle,int> live,otherLive;
+    int wrong=0;
+    for(int i=0;i<30000;i++)
+    {
+        int op=Rand()%10,value=Rand()%10000;
+        if(op<3 || live.empty())live[p.push(value)]=value;
+        else if(op==3)otherLive[other.push(value)]=value;
+        else if(op==4)
+        {
+            p.meld(std::move(other));
+            for(auto &e:otherLive)live.insert(e);
+            otherLive.clear();
+            if(!other.empty())wrong++;
+        }else
+        {
+            auto it=live.begin();
+            advance(it,Rand()%live.size());
+            if(op==5)
+            {
+                p.update(it->first,value);
+                it->second=value;
+            }else if(op==6)
+            {
+                bool lower=value<it->second;
+                if(p.decreaseKey(it->first,value)!=lower)wrong++;
+                if(lower)it->second=value;
+            }else if(op==7)
+            {
+                p.erase(it->first);
+                live.erase(it);
+            }else
+            {
+                int least=INT_MAX;
+                for(auto &e:live)least=min(least,e.second);
+                if(p.front()!=least)wrong++;
+                for(auto e=live.begin();e!=live.end();++e)
+                    if(e->second==least)
+                    {
+                        p.erase(e->first);
+                        live.erase(e);
+                        break;
+                    }
+            }
+        }
+        if(p.size()!=(int)live.size())wrong++;
+        if(i%1000==0)
+            for(auto &e:live)
+                if(p.get(e.first)!=e.second)wrong++;
+    }
+    multiset<int> all,seen;
+    for(auto &e:live)all.insert(e.second);
+    PairingHeap<int> copy(p);
+    for(auto it=copy.iterator();it.hasNext();)seen.insert(it.next());
+    if(seen!=all)wrong++;
+    int removed=0;
+    for(auto it=p.iterator();it.hasNext();)
+    {
+        int value=it.next();
+        if(Rand()%2)
+        {
+            it.remove();
+            all.erase(all.find(value));
+            removed++;
+        }
+    }
+    for(auto x:all)
+    {
+        if(p.front()!=x)wrong++;
+        p.pop();
+    }
+    PairingHeap<int> chain;
+    for(int i=100000;i>0;i--)chain.push(i);
+    chain.pop();
+    cout<<wrong<<' '<<(removed>0)<<' '<<p.empty()<<' '<<copy.size()<<' '<<chain.front()<<' '<<chain.size()<<endl;
+    try{ p.pop(); }catch(ElementNotExist e){ cout<<"pop OK"<<endl; }
+    puts("Done pairing heap test");
+}
+
+template <class K>
+int testRadix(unsigned long long range)
+{
+    MonotonePriorityQueue<K> q;
+    priority_queue<K,vector<K>,greater<K> > r;
+    K last=0;
+    int wrong=0;
+    for(int i=0;i<30000;i++)
+    {
+        int op=Rand()%5;
+        if(op<2)
+        {
+            unsigned long long step=((unsigned long long)Rand()*65537+Rand())%range;
+            K key=(K)(last+step);
+            if(key<last)key=last;
+            q.push(key);
+            r.push(key);
+        }else if(op<4 && !r.empty())
+        {
+            if(q.front()!=r.top())wrong++;
+            last=r.top();
+            q.pop();
+            r.pop();
+        }else if(i%3000==0)
+        {
+            q.clear();
+            while(!r.empty())r.pop();
+        }
+        if(q.size()!=(int)r.size())wrong++;
+    }
+    return wrong;
+}
+
+void testMonotoneHeap()
+{
+    cout<<testRadix<unsigned long long>(1ULL<<40)<<' '<<testRadix<unsigned long long>(3)<<' ';
+    cout<<testRadix<unsigned>(1000)<<' '<<testRadix<unsigned short>(300)<<' '<<testRadix<unsigned char>(7)<<endl;
+    MonotonePriorityQueue<> q;
+    q.push(~0ULL);
+    q.push(5);
+    q.push(5);
+    cout<<q.front()<<' ';
+    q.pop();
+    q.pop();
+    cout<<q.front()<<' '<<q.size()<<endl;
+    q.pop();
+    q.push(1);
+    cout<<q.front()<<endl;
+    q.clear();
+    try{ q.front(); }catch(ElementNotExist e){ cout<<"front OK"<<endl; }
+    puts("Done monotone heap test");
+}
+
 int main()
 {
     testDeque();
@@ -367,4 +1482,60 @@ int main()
     puts("-----------------------------------------");
     testHeap2();
     puts("-----------------------------------------");
+    testHashMin();
+    puts("-----------------------------------------");
+    testMapped();
+    puts("-----------------------------------------");
+    testConcurrentHash();
+    puts("-----------------------------------------");
+    testHashAccess();
+    puts("-----------------------------------------");
+    testHashArena();
+    puts("-----------------------------------------");
+    testHashBatch();
+    puts("-----------------------------------------");
+    testHashStats();
+    puts("-----------------------------------------");
+    testHashSetMulti();
+    puts("-----------------------------------------");
+    testHashFind();
+    puts("-----------------------------------------");
+    testHashFilter();
+    puts("-----------------------------------------");
+    testTreeArenaMoves();
+    puts("-----------------------------------------");
+    testTreeRank();
+    puts("-----------------------------------------");
+    testTreeIterate();
+    puts("-----------------------------------------");
+    testTreeNavigate();
+    puts("-----------------------------------------");
+    testTreeMutate();
+    puts("-----------------------------------------");
+    testBTree();
+    puts("-----------------------------------------");
+    testTreeSeed();
+    puts("-----------------------------------------");
+    testTreeSetOps();
+    puts("-----------------------------------------");
+    testTreeSnapshot();
+    puts("-----------------------------------------");
+    testConcurrentTree();
+    puts("-----------------------------------------");
+    testTreeAggregate();
+    puts("-----------------------------------------");
+    testTreeArena();
+    puts("-----------------------------------------");
+    testTreeNoCopy();
+    puts("-----------------------------------------");
+    testDaryHeap();
+    puts("-----------------------------------------");
+    testHeap3();
+    puts("-----------------------------------------");
+    testHeapBatch();
+    puts("-----------------------------------------");
+    testPairingHeap();
+    puts("-----------------------------------------");
+    testMonotoneHeap();
+    puts("-----------------------------------------");
 }